@@ -0,0 +1,40 @@
+//
+//  Allocations.cpp
+//  benchmark
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#include "Allocations.hpp"
+
+namespace {
+
+std::atomic<long long> allocations(0);
+
+}
+
+long long Allocations::count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+// The array and nothrow forms go through this one
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
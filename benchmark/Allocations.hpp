@@ -0,0 +1,23 @@
+//
+//  Allocations.hpp
+//  benchmark
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Allocations_hpp
+#define Allocations_hpp
+
+#include <cstddef>
+
+// Heap allocations of the program, every thread included
+// The benchmark replaces the global operator new with one counting its calls, so that the report
+// shows how many allocations a case makes once warm: none for the estimator kernels, and for a
+// whole fit a number that does not grow with the pixels.
+class Allocations {
+public:
+    static long long count();
+};
+
+#endif /* Allocations_hpp */
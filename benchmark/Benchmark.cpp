@@ -0,0 +1,143 @@
+//
+//  Benchmark.cpp
+//  benchmark
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+
+Benchmark::Benchmark() {
+    min_time = 0.5;
+    threads = 0;
+}
+
+void Benchmark::setMinTime(double seconds) {
+    min_time = seconds;
+}
+
+// Only the cases whose name contains 'f' are run
+void Benchmark::setFilter(std::string f) {
+    filter = f;
+}
+
+// Recorded in the report, the cases are responsible for using it
+void Benchmark::setThreads(int t) {
+    threads = t;
+}
+
+bool Benchmark::isSelected(std::string name) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+// Time 'body' processing 'items' per call, after one untimed call when it is short enough
+void Benchmark::run(std::string name, const Parameters & parameters, double items, int min_iterations, const std::function<std::uint64_t()> & body) {
+    if (!isSelected(name))
+        return;
+    
+    typedef std::chrono::steady_clock Clock;
+    
+    Result result;
+    result.name = name;
+    result.parameters = parameters;
+    result.items = items;
+    
+    std::vector<double> times;
+    double total = 0.;
+    
+    // Warm-up: caches, lazily built tables, page faults of fresh buffers
+    long long allocations = Allocations::count();
+    auto t0 = Clock::now();
+    result.checksum = body();
+    result.allocations = Allocations::count() - allocations;
+    double first = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (first >= min_time) {
+        times.push_back(first);
+        total = first;
+    }
+    
+    while (total < min_time || (int) times.size() < min_iterations) {
+        allocations = Allocations::count();
+        t0 = Clock::now();
+        result.checksum = body();
+        double t = std::chrono::duration<double>(Clock::now() - t0).count();
+        result.allocations = Allocations::count() - allocations;
+        times.push_back(t);
+        total += t;
+    }
+    
+    std::sort(times.begin(), times.end());
+    result.iterations = (int) times.size();
+    result.min = times.front();
+    result.median = times[times.size() / 2];
+    result.mean = total / times.size();
+    results.push_back(result);
+    
+    std::cout << name;
+    for (const auto& parameter : parameters)
+        std::cout << " " << parameter.first << "=" << parameter.second;
+    std::printf("  median %.4g ms  min %.4g ms  %.3g items/s  %lld allocations  (%d runs)\n",
+                1000. * result.median, 1000. * result.min, items / result.median, result.allocations, result.iterations);
+    std::fflush(stdout);
+}
+
+bool Benchmark::write(std::string path) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "ERROR: cannot write " << path << "\n";
+        return false;
+    }
+    
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    
+    file << "{\n";
+    file << "  \"suite\": \"video-segmentation\",\n";
+    file << "  \"date\": \"" << date << "\",\n";
+    file << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    file << "  \"threads\": " << threads << ",\n";
+    file << "  \"min_time\": " << format(min_time) << ",\n";
+    file << "  \"results\": [";
+    for (std::size_t r = 0; r < results.size(); r++) {
+        const Result& result = results[r];
+        char checksum[20];
+        std::snprintf(checksum, sizeof(checksum), "%016llx", (unsigned long long) result.checksum);
+        
+        file << (r > 0 ? ",\n" : "\n");
+        file << "    {\"name\": \"" << result.name << "\", \"parameters\": {";
+        for (std::size_t p = 0; p < result.parameters.size(); p++)
+            file << (p > 0 ? ", " : "") << "\"" << result.parameters[p].first << "\": " << format(result.parameters[p].second);
+        file << "}, \"iterations\": " << result.iterations;
+        file << ", \"min_ms\": " << format(1000. * result.min);
+        file << ", \"median_ms\": " << format(1000. * result.median);
+        file << ", \"mean_ms\": " << format(1000. * result.mean);
+        file << ", \"items\": " << format(result.items);
+        file << ", \"items_per_second\": " << format(result.items / result.median);
+        file << ", \"allocations\": " << result.allocations;
+        file << ", \"checksum\": \"" << checksum << "\"}";
+    }
+    file << "\n  ]\n}\n";
+    
+    return bool(file);
+}
+
+// FNV-1a, chained through 'h'
+std::uint64_t Benchmark::hash(const void* data, std::size_t size, std::uint64_t h) {
+    const unsigned char* b = (const unsigned char*) data;
+    for (std::size_t i = 0; i < size; i++) {
+        h ^= b[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Nine significant digits, JSON has no inf or nan
+std::string Benchmark::format(double x) {
+    if (!std::isfinite(x))
+        return "null";
+    char s[32];
+    std::snprintf(s, sizeof(s), "%.9g", x);
+    return s;
+}
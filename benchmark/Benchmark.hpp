@@ -0,0 +1,68 @@
+//
+//  Benchmark.hpp
+//  benchmark
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include "Allocations.hpp"
+
+// Timing loop and JSON report of the benchmark suite
+// A case is run until it has taken 'min_time' seconds and at least 'min_iterations' times.
+// Its body returns a checksum of what it computed, which is kept in the report so that a
+// change of the results shows next to a change of the timings, with the heap allocations it made.
+class Benchmark {
+public:
+    typedef std::vector<std::pair<std::string, double>> Parameters;
+    
+    Benchmark();
+    
+    void setMinTime(double);
+    void setFilter(std::string);
+    void setThreads(int);
+    bool isSelected(std::string);
+    
+    void run(std::string, const Parameters &, double, int, const std::function<std::uint64_t()> &);
+    
+    bool write(std::string);
+    
+    static std::uint64_t hash(const void*, std::size_t, std::uint64_t = 14695981039346656037ull);
+    
+private:
+    struct Result {
+        std::string name;
+        Parameters parameters;
+        int iterations;
+        double min, median, mean; // Seconds
+        double items;             // Processed per iteration: pixels, samples...
+        std::uint64_t checksum;
+        long long allocations;    // Heap allocations of the last iteration
+    };
+    
+    static std::string format(double);
+    
+    std::vector<Result> results;
+    double min_time;
+    std::string filter;
+    int threads;
+};
+
+#endif /* Benchmark_hpp */
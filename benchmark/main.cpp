@@ -0,0 +1,384 @@
+//
+//  main.cpp
+//  benchmark
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+#include "FrameStore.hpp"
+#include "SyntheticSource.hpp"
+#include "ColorSpace.hpp"
+#include "MLEstimator.hpp"
+#include "KDEstimator.hpp"
+#include "StreamingMLEstimator.hpp"
+#include "MaskExtractor.hpp"
+#include "ThresholdIndex.hpp"
+#include "PottsSegmenter.hpp"
+#include "DPEstimator.hpp"
+
+namespace {
+
+const std::size_t MEMORY_BUDGET = std::size_t(4096) * 1024 * 1024;
+const float LOG_THRESHOLD = -10.f;
+
+struct Settings {
+    bool quick = false;
+    int threads = 0;
+};
+
+std::string getSpec(int width, int height, int frames) {
+    return "synthetic:" + std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(frames);
+}
+
+// Colours of the centre pixel of a small synthetic sequence, which a blob crosses now and then
+Vector3Array getSamples(int n) {
+    SyntheticSource source;
+    source.open(getSpec(32, 32, n));
+    
+    ColorSpace colorspace;
+    std::vector<sf::Uint8> frame(4 * 32 * 32);
+    Vector3Array samples(n);
+    for (int k = 0; k < n; k++) {
+        source.read(k, frame.data());
+        const sf::Uint8* px = &frame[4 * (16 * 32 + 16)];
+        samples.set(k, ColorSpace::convert(ColorSpace::HSL, sf::Color(px[0], px[1], px[2])));
+    }
+    return samples;
+}
+
+// Density plane of the last frame of a synthetic sequence under the online model
+std::vector<float> getDensities(int width, int height, int frames) {
+    FrameStore store;
+    store.open(getSpec(width, height, frames), MEMORY_BUDGET, 0);
+    
+    StreamingMLEstimator estimator;
+    estimator.create(width * height, 1.);
+    ColorSpace colorspace;
+    
+    Vector3Array frame;
+    std::vector<float> density(std::size_t(width) * height);
+    for (int k = 0; k < frames; k++) {
+        colorspace.convert(store.getFrame(k), width * height, frame);
+        estimator.update(frame, density.data());
+    }
+    return density;
+}
+
+void benchmarkColor(Benchmark & benchmark) {
+    const int width = 640, height = 480;
+    SyntheticSource source;
+    source.open(getSpec(width, height, 1));
+    std::vector<sf::Uint8> frame(4 * width * height);
+    source.read(0, frame.data());
+    
+    for (ColorSpace::Space space : {ColorSpace::HSL, ColorSpace::YCBCR, ColorSpace::RGB, ColorSpace::LAB}) {
+        for (bool table : {false, true}) {
+            std::string name = "color." + ColorSpace::getName(space) + (table ? "-table" : "");
+            if (!benchmark.isSelected(name) || (table && space != ColorSpace::LAB))
+                continue;
+            
+            ColorSpace colorspace;
+            colorspace.setSpace(space, table);
+            Vector3Array converted;
+            benchmark.run(name, {{"width", width}, {"height", height}}, double(width) * height, 5, [&]() {
+                colorspace.convert(frame.data(), width * height, converted);
+                return Benchmark::hash(converted.x.data(), converted.x.size() * sizeof(float));
+            });
+        }
+    }
+}
+
+void benchmarkEstimators(Benchmark & benchmark, const Settings & settings) {
+    std::vector<int> sizes = settings.quick ? std::vector<int>{50, 200} : std::vector<int>{50, 200, 1000, 4000};
+    
+    for (int n : sizes) {
+        Vector3Array samples = getSamples(n);
+        
+        benchmark.run("mle.fit", {{"samples", n}}, n, 5, [&]() {
+            MLEstimator estimator;
+            estimator.fit(samples);
+            float y = estimator.evaluate(samples.get(0), true);
+            return Benchmark::hash(&y, sizeof(y));
+        });
+        
+        // The estimators and outputs are reused as in the fit loop: warm, they do not allocate
+        std::vector<float> y(n);
+        MLEstimator fitted;
+        fitted.fit(samples);
+        benchmark.run("mle.evaluate", {{"samples", n}}, n, 5, [&]() {
+            fitted.evaluate(samples, true, y.data());
+            return Benchmark::hash(y.data(), y.size() * sizeof(float));
+        });
+        
+        for (float tolerance : {0.f, 0.01f}) {
+            KDEstimator estimator;
+            estimator.setTolerance(tolerance);
+            benchmark.run(tolerance > 0. ? "kde.binned" : "kde.exact", {{"samples", n}, {"tolerance", tolerance}}, n, 5, [&]() {
+                estimator.fit_evaluate(samples, y.data());
+                return Benchmark::hash(y.data(), y.size() * sizeof(float));
+            });
+        }
+    }
+}
+
+void benchmarkMasks(Benchmark & benchmark) {
+    const int width = 640, height = 480, frames = 50;
+    if (!benchmark.isSelected("mask.extract") && !benchmark.isSelected("mask.spread") &&
+        !benchmark.isSelected("index.build") && !benchmark.isSelected("index.query"))
+        return;
+    std::vector<float> density = getDensities(width, height, frames);
+    double pixels = double(width) * height;
+    
+    // Without hysteresis the mask is the plane below s, with it the seeds spread to their neighbours
+    for (float gap : {0.f, 2.f}) {
+        MaskExtractor extractor;
+        extractor.create(width, height);
+        float s = expf(LOG_THRESHOLD), s2 = expf(LOG_THRESHOLD + gap);
+        benchmark.run(gap > 0. ? "mask.spread" : "mask.extract", {{"width", width}, {"height", height}, {"gap", gap}}, pixels, 5, [&]() {
+            const sf::Uint8* mask = extractor.extract(density.data(), s, s2);
+            return Benchmark::hash(mask, 4 * std::size_t(width) * height);
+        });
+    }
+    
+    float s2 = expf(LOG_THRESHOLD + 2.f);
+    ThresholdIndex index;
+    benchmark.run("index.build", {{"width", width}, {"height", height}}, pixels, 5, [&]() {
+        index.build(density.data(), width, height, s2 * expf(3.));
+        return (std::uint64_t) index.getComponents().size();
+    });
+    
+    index.build(density.data(), width, height, s2 * expf(3.));
+    int step = 0;
+    benchmark.run("index.query", {{"width", width}, {"height", height}}, pixels, 5, [&]() {
+        // Thresholds moved the way the viewer does, a tenth of a log unit at a time
+        float log_s = LOG_THRESHOLD - 0.1f * (step++ % 10);
+        const sf::Uint8* mask = index.query(expf(log_s), expf(log_s + 2.f));
+        return Benchmark::hash(mask, 4 * std::size_t(width) * height);
+    });
+}
+
+// Potts regularized masks at 1080p, the latency of a frame in the viewer
+void benchmarkSmoothing(Benchmark & benchmark, const Settings & settings) {
+    const int width = 1920, height = 1080, frames = 20;
+    if (!benchmark.isSelected("mask.potts") && !benchmark.isSelected("mask.potts-converged"))
+        return;
+    std::vector<float> density = getDensities(width, height, frames);
+    double pixels = double(width) * height;
+    float s = expf(LOG_THRESHOLD), s2 = expf(LOG_THRESHOLD + 2.f);
+    
+    MaskExtractor extractor;
+    PottsSegmenter potts;
+    potts.create(width, height);
+    potts.setThreads(settings.threads);
+    potts.setSmoothness(1.);
+    
+    // The default budget of 30 ms, then the sweeps until no label changes
+    for (float budget : {30.f, 0.f}) {
+        potts.setBudget(budget);
+        std::string name = budget > 0. ? "mask.potts" : "mask.potts-converged";
+        benchmark.run(name, {{"width", width}, {"height", height}, {"budget", budget}}, pixels, 5, [&]() {
+            const sf::Uint8* mask = potts.segment(density.data(), s, s2, extractor);
+            return Benchmark::hash(mask, 4 * std::size_t(width) * height);
+        });
+        std::cout << "INFO: " << name << " " << potts.getSweeps() << " sweeps\n";
+    }
+}
+
+void benchmarkEvaluate(Benchmark & benchmark, const Settings & settings) {
+    const int width = 640, height = 480, frames = 50;
+    bool selected = false;
+    for (std::string name : {"evaluate.frame", "evaluate.retune", "evaluate.frame-half", "evaluate.frame-log8", "evaluate.frame-bits"})
+        selected = selected || benchmark.isSelected(name);
+    if (!selected)
+        return;
+    
+    FrameStore store;
+    store.open(getSpec(width, height, frames), MEMORY_BUDGET, settings.threads);
+    DPEstimator estimator;
+    estimator.setThreads(settings.threads);
+    estimator.fit(store, "mle");
+    
+    double pixels = double(width) * height;
+    float s = expf(LOG_THRESHOLD), s2 = expf(LOG_THRESHOLD + 2.f);
+    
+    // A new frame each time: the extractor runs on the density plane
+    int k = 0;
+    benchmark.run("evaluate.frame", {{"width", width}, {"height", height}}, pixels, 5, [&]() {
+        k = (k + 1) % frames;
+        const sf::Uint8* mask = estimator.evaluate(k, s, s2);
+        return Benchmark::hash(mask, 4 * std::size_t(width) * height);
+    });
+    
+    // The same frame with moving thresholds: answered by the component tree
+    int step = 0;
+    benchmark.run("evaluate.retune", {{"width", width}, {"height", height}}, pixels, 5, [&]() {
+        float log_s = LOG_THRESHOLD - 0.1f * (step++ % 10);
+        const sf::Uint8* mask = estimator.evaluate(0, expf(log_s), expf(log_s + 2.f));
+        return Benchmark::hash(mask, 4 * std::size_t(width) * height);
+    });
+    
+    // Compact densities, the extractor reading the codes
+    for (CompactTensor::Format format : {CompactTensor::FLOAT16, CompactTensor::LOG8, CompactTensor::BITPLANE}) {
+        std::string name = "evaluate.frame-" + CompactTensor::getName(format);
+        if (!benchmark.isSelected(name))
+            continue;
+        
+        DPEstimator compact;
+        compact.setThreads(settings.threads);
+        compact.setStorage(format, {s, s2}, MEMORY_BUDGET);
+        compact.fit(store, "mle");
+        
+        benchmark.run(name, {{"width", width}, {"height", height}}, pixels, 5, [&]() {
+            k = (k + 1) % frames;
+            const sf::Uint8* mask = compact.evaluate(k, s, s2);
+            return Benchmark::hash(mask, 4 * std::size_t(width) * height);
+        });
+    }
+}
+
+// Masks of every frame of a fit, as a single hash or into 'masks'
+std::uint64_t getMasks(DPEstimator & estimator, int frames, std::size_t bytes, std::vector<sf::Uint8>* masks) {
+    std::uint64_t h = Benchmark::hash(nullptr, 0);
+    float s = expf(LOG_THRESHOLD), s2 = expf(LOG_THRESHOLD + 2.f);
+    for (int k = 0; k < frames; k++) {
+        const sf::Uint8* mask = estimator.evaluate(k, s, s2);
+        h = Benchmark::hash(mask, bytes, h);
+        if (masks != nullptr)
+            masks->insert(masks->end(), mask, mask + bytes);
+    }
+    return h;
+}
+
+// Fit coarse to fine against the fit of every pixel. The agreement is the fraction of the mask
+// pixels of every frame equal to the ones of the full fit, computed once before timing.
+void benchmarkPyramid(Benchmark & benchmark, const Settings & settings) {
+    const int width = 320, height = 240, frames = settings.quick ? 50 : 100;
+    std::vector<std::pair<int, float>> pyramids = {{1, 0.f}, {4, 0.1f}, {4, 0.25f}, {4, 1.f}};
+    
+    std::vector<std::string> methods;
+    for (std::string method : {"mle", "kde", "gmm"})
+        if (benchmark.isSelected("pyramid." + method))
+            methods.push_back(method);
+    if (methods.empty())
+        return;
+    
+    FrameStore store;
+    store.open(getSpec(width, height, frames), MEMORY_BUDGET, settings.threads);
+    std::size_t bytes = 4 * std::size_t(width) * height;
+    std::vector<float> thresholds = {expf(LOG_THRESHOLD), expf(LOG_THRESHOLD + 2.f)};
+    
+    for (std::string method : methods) {
+        std::vector<sf::Uint8> reference;
+        for (auto pyramid : pyramids) {
+            auto fit = [&](DPEstimator & estimator) {
+                estimator.setThreads(settings.threads);
+                estimator.setPyramid(pyramid.first, pyramid.second, thresholds);
+                estimator.fit(store, method);
+            };
+            
+            std::vector<sf::Uint8> masks;
+            DPEstimator estimator;
+            fit(estimator);
+            getMasks(estimator, frames, bytes, &masks);
+            if (reference.empty())
+                reference = masks;
+            std::size_t equal = 0;
+            for (std::size_t p = 0; p < masks.size(); p += 4)
+                equal += masks[p] == reference[p];
+            
+            Benchmark::Parameters parameters = {{"width", width}, {"height", height}, {"frames", frames},
+                {"factor", pyramid.first}, {"refine", pyramid.second}, {"agreement", 4. * equal / masks.size()}};
+            benchmark.run("pyramid." + method, parameters, double(width) * height * frames, 3, [&]() {
+                DPEstimator estimator;
+                fit(estimator);
+                return getMasks(estimator, frames, bytes, nullptr);
+            });
+        }
+    }
+}
+
+// Fit and masks of every frame, as the headless batch does
+void benchmarkPipeline(Benchmark & benchmark, const Settings & settings) {
+    std::vector<std::pair<int, int>> resolutions = {{160, 120}, {320, 240}, {640, 480}};
+    std::vector<int> lengths = {50, 200};
+    if (settings.quick) {
+        resolutions = {{160, 120}};
+        lengths = {50};
+    }
+    
+    std::vector<std::string> methods;
+    for (std::string method : {"mle", "kde", "kde-binned", "online"})
+        if (benchmark.isSelected("pipeline." + method))
+            methods.push_back(method);
+    if (methods.empty())
+        return;
+    
+    for (auto resolution : resolutions) {
+        for (int frames : lengths) {
+            int width = resolution.first, height = resolution.second;
+            FrameStore store;
+            store.open(getSpec(width, height, frames), MEMORY_BUDGET, settings.threads);
+            
+            for (std::string method : methods) {
+                std::string name = "pipeline." + method;
+                Benchmark::Parameters parameters = {{"width", width}, {"height", height}, {"frames", frames}};
+                benchmark.run(name, parameters, double(width) * height * frames, 3, [&]() {
+                    DPEstimator estimator;
+                    estimator.setThreads(settings.threads);
+                    if (method.compare("kde-binned") == 0)
+                        estimator.setKDETolerance(0.01);
+                    estimator.fit(store, method.compare("kde-binned") == 0 ? "kde" : method);
+                    
+                    std::uint64_t h = Benchmark::hash(nullptr, 0);
+                    for (int k = 0; k < frames; k++)
+                        h = Benchmark::hash(estimator.evaluate(k, expf(LOG_THRESHOLD), expf(LOG_THRESHOLD)), 4 * std::size_t(width) * height, h);
+                    return h;
+                });
+            }
+        }
+    }
+}
+
+}
+
+int main(int argc, const char * argv[]) {
+    Benchmark benchmark;
+    Settings settings;
+    std::string output_path = "benchmark.json";
+    
+    for (int i = 0; i < argc; i++) {
+        if (argc > i+1 && std::strcmp(argv[i], "--out") == 0)
+            output_path = std::string(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--filter") == 0)
+            benchmark.setFilter(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--min-time") == 0)
+            benchmark.setMinTime(std::stod(argv[i+1]));
+        if (argc > i+1 && std::strcmp(argv[i], "--threads") == 0)
+            settings.threads = std::stoi(argv[i+1]);
+        if (std::strcmp(argv[i], "--quick") == 0)
+            settings.quick = true;
+    }
+    benchmark.setThreads(settings.threads);
+    
+    benchmarkColor(benchmark);
+    benchmarkEstimators(benchmark, settings);
+    benchmarkMasks(benchmark);
+    benchmarkSmoothing(benchmark, settings);
+    benchmarkEvaluate(benchmark, settings);
+    benchmarkPyramid(benchmark, settings);
+    benchmarkPipeline(benchmark, settings);
+    
+    if (!benchmark.write(output_path))
+        return 1;
+    std::cout << "INFO: results written to " << output_path << "\n";
+    
+    return 0;
+}
@@ -0,0 +1,122 @@
+//
+//  Batch.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "Batch.hpp"
+
+Batch::Batch(const Options & opt) {
+    options = opt;
+    
+    threshold = expf(options.log_threshold);
+    threshold2 = expf(options.log_threshold + options.delta_log_threshold);
+}
+
+bool Batch::run() {
+    if (options.output_path.compare("") == 0) {
+        std::cout << "ERROR: output path not given\n";
+        return false;
+    }
+    fs::create_directories(options.output_path);
+    
+    // Out of core, half of the budget goes to the frames and half to the density bands
+    budget = options.spill_path.empty() ? options.memory_budget : options.memory_budget / 2;
+    
+    if (!frames.open(options.input_path, budget, options.threads))
+        return false;
+    
+    // Masks are encoded by half of the threads while the next ones are computed
+    int n_threads = options.threads > 0 ? options.threads : (int) std::thread::hardware_concurrency();
+    int n_writers = std::max(1, n_threads / 2);
+    writer.start(n_writers, 2 * n_writers);
+    
+    // With a cache the online densities are kept so that a later run only streams the appended frames
+    if (options.method.compare("online") == 0 && options.cache_path.empty())
+        runStream();
+    else
+        runTensor();
+    
+    writer.finish();
+    std::cout << "INFO: " << frames.size() << " masks written to " << options.output_path << "\n";
+    
+    return writer.getFailures() == 0;
+}
+
+// Fit the whole sequence, then extract the masks
+void Batch::runTensor() {
+    DPEstimator dpestimator;
+    dpestimator.setLayout(options.tensor_layout);
+    dpestimator.setThreads(options.threads);
+    dpestimator.setKDETolerance(options.kde_tolerance);
+    dpestimator.setColorSpace(options.color_space, options.color_table);
+    dpestimator.setForgetting(options.forgetting);
+    dpestimator.setWindow(options.window);
+    dpestimator.setPyramid(options.pyramid, options.refine, {threshold, threshold2});
+    dpestimator.setGMM(options.gmm_components, options.gmm_covariance);
+    dpestimator.setSpill(options.spill_path, budget);
+    dpestimator.setCache(options.cache_path);
+    dpestimator.setStorage(options.storage, {threshold, threshold2}, budget);
+    dpestimator.setSmoothness(options.smoothness, options.smoothing_budget);
+    
+    std::cout << "INFO: Running segmentation algorithm - " << options.method << "\n";
+    dpestimator.fit(frames, options.method);
+    
+    std::cout << "INFO: Extract segmentation masks\n";
+    for (int k = 0; k < frames.size(); k++)
+        write(k, dpestimator.evaluate(k, threshold, threshold2));
+}
+
+// Online estimator: each mask is written as soon as its frame is ingested, in constant memory
+void Batch::runStream() {
+    int width = frames.getSize().x, height = frames.getSize().y;
+    
+    StreamingMLEstimator estimator;
+    estimator.create(width * height, options.forgetting);
+    estimator.setThreads(options.threads);
+    
+    ColorSpace colorspace;
+    colorspace.setSpace(options.color_space, options.color_table);
+    
+    std::cout << "INFO: Running segmentation algorithm - online\n";
+    MaskExtractor extractor;
+    extractor.create(width, height);
+    PottsSegmenter potts;
+    potts.create(width, height);
+    potts.setThreads(options.threads);
+    potts.setSmoothness(options.smoothness);
+    potts.setBudget(options.smoothing_budget);
+    
+    Vector3Array frame;
+    std::vector<float> density(std::size_t(width) * height);
+    Progress progress("online", (long long) frames.size() * width * height);
+    for (int k = 0; k < frames.size(); k++) {
+        const sf::Uint8* pixels = frames.getFrame(k);
+        {
+            Profiler::Scope scope(Profiler::FIT, (long long) width * height);
+            {
+                Profiler::Scope color_scope(Profiler::COLOR, (long long) width * height);
+                colorspace.convert(pixels, width * height, frame);
+            }
+            estimator.update(frame, density.data());
+        }
+        if (options.smoothness > 0.)
+            write(k, potts.segment(density.data(), threshold, threshold2, extractor));
+        else
+            write(k, extractor.extract(density.data(), threshold, threshold2));
+        progress.advance((long long) width * height);
+    }
+    progress.finish();
+}
+
+std::string Batch::getMaskPath(int k) {
+    return (fs::path(options.output_path) / frames.getName(k)).string() + ".png";
+}
+
+void Batch::write(int k, const sf::Uint8* pixels) {
+    sf::Image mask;
+    mask.create(frames.getSize().x, frames.getSize().y, pixels);
+    writer.push(getMaskPath(k), mask);
+}
@@ -0,0 +1,54 @@
+//
+//  Batch.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Batch_hpp
+#define Batch_hpp
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include <SFML/Graphics.hpp>
+
+#include "DPEstimator.hpp"
+#include "StreamingMLEstimator.hpp"
+#include "FrameStore.hpp"
+#include "MaskWriter.hpp"
+#include "ColorSpace.hpp"
+#include "MaskExtractor.hpp"
+#include "PottsSegmenter.hpp"
+#include "Options.hpp"
+#include "Profiler.hpp"
+#include "Progress.hpp"
+
+namespace fs = std::filesystem;
+
+// Headless segmentation: fits the chosen estimator only and writes the mask of every frame
+class Batch {
+public:
+    Batch(const Options &);
+    bool run();
+    
+private:
+    void runTensor();
+    void runStream();
+    
+    std::string getMaskPath(int);
+    void write(int, const sf::Uint8*);
+    
+    Options options;
+    float threshold, threshold2;
+    
+    FrameStore frames;
+    std::size_t budget; // Bytes of decoded frames, and of density bands out of core
+    MaskWriter writer;
+};
+
+#endif /* Batch_hpp */
@@ -0,0 +1,330 @@
+//
+//  ColorSpace.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "ColorSpace.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLORSPACE_X86
+#endif
+
+namespace {
+    typedef void (*BatchFunction)(const sf::Uint8*, int, float*, float*, float*);
+    
+    // Per channel tables, the products are those of the per-pixel conversion
+    struct Tables {
+        float unit[256];                        // c / 255
+        double y[3][256], cb[3][256], cr[3][256]; // YCbCr coefficients times c
+        double linear[256];                     // sRGB to linear RGB
+        
+        Tables() {
+            for (int c = 0; c < 256; c++) {
+                unit[c] = float(c)/255.;
+                
+                y[0][c] = 0.299 * float(c);
+                y[1][c] = 0.587 * float(c);
+                y[2][c] = 0.114 * float(c);
+                cb[0][c] = 0.1687 * float(c);
+                cb[1][c] = 0.3313 * float(c);
+                cb[2][c] = 0.5 * float(c);
+                cr[0][c] = 0.5 * float(c);
+                cr[1][c] = 0.4187 * float(c);
+                cr[2][c] = 0.0813 * float(c);
+                
+                double v = double(c) / 255.;
+                linear[c] = v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+            }
+        }
+    };
+    
+    const Tables tables;
+    
+    float maximum(float a, float b) {
+        return a > b ? a : b;
+    }
+    
+    float minimum(float a, float b) {
+        return a < b ? a : b;
+    }
+    
+    // CIE Lab f(t)
+    double lab_f(double t) {
+        return t > 216. / 24389. ? std::cbrt(t) : (24389. / 27. * t + 16.) / 116.;
+    }
+    
+    Vector3 lab(int r, int g, int b) {
+        double R = tables.linear[r], G = tables.linear[g], B = tables.linear[b];
+        
+        // Linear RGB to XYZ (D65), relative to the white point
+        double fx = lab_f((0.4124564 * R + 0.3575761 * G + 0.1804375 * B) / 0.95047);
+        double fy = lab_f( 0.2126729 * R + 0.7151522 * G + 0.0721750 * B);
+        double fz = lab_f((0.0193339 * R + 0.1191920 * G + 0.9503041 * B) / 1.08883);
+        
+        return Vector3(116. * fy - 16., 500. * (fx - fy), 200. * (fy - fz));
+    }
+    
+    void hsl_scalar(const sf::Uint8* rgba, int n, float* x, float* y, float* z) {
+        for (int p = 0; p < n; p++) {
+            const sf::Uint8* c = rgba + 4*p;
+            Vector3 v = ColorSpace::convert(ColorSpace::HSL, sf::Color(c[0], c[1], c[2]));
+            x[p] = v.x;
+            y[p] = v.y;
+            z[p] = v.z;
+        }
+    }
+    
+#ifdef COLORSPACE_X86
+    // H of 4 pixels, computed in double like the per-pixel conversion
+    __attribute__((target("avx2")))
+    inline __m128 hue_avx2(__m128 R, __m128 G, __m128 B, __m128 V, __m128 C) {
+        __m256d c60 = _mm256_set1_pd(60.);
+        __m256d Cd = _mm256_cvtps_pd(C);
+        
+        __m256d hr = _mm256_div_pd(_mm256_mul_pd(c60, _mm256_cvtps_pd(_mm_sub_ps(G, B))), Cd);
+        __m256d hg = _mm256_mul_pd(c60, _mm256_add_pd(_mm256_set1_pd(2.), _mm256_cvtps_pd(_mm_div_ps(_mm_sub_ps(B, R), C))));
+        __m256d hb = _mm256_mul_pd(c60, _mm256_add_pd(_mm256_set1_pd(4.), _mm256_cvtps_pd(_mm_div_ps(_mm_sub_ps(R, G), C))));
+        
+        __m128 H = _mm256_cvtpd_ps(hb);
+        H = _mm_blendv_ps(H, _mm256_cvtpd_ps(hg), _mm_cmpeq_ps(V, G));
+        H = _mm_blendv_ps(H, _mm256_cvtpd_ps(hr), _mm_cmpeq_ps(V, R));
+        H = _mm_andnot_ps(_mm_cmpeq_ps(C, _mm_setzero_ps()), H);
+        
+        return _mm256_cvtpd_ps(_mm256_div_pd(_mm256_cvtps_pd(H), _mm256_set1_pd(360.)));
+    }
+    
+    __attribute__((target("avx2")))
+    void hsl_avx2(const sf::Uint8* rgba, int n, float* x, float* y, float* z) {
+        const __m256i byte = _mm256_set1_epi32(0xFF);
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f), half = _mm256_set1_ps(0.5f);
+        
+        int p = 0;
+        for (; p + 8 <= n; p += 8) {
+            __m256i px = _mm256_loadu_si256((const __m256i*) (rgba + 4*p));
+            __m256 R = _mm256_i32gather_ps(tables.unit, _mm256_and_si256(px, byte), 4);
+            __m256 G = _mm256_i32gather_ps(tables.unit, _mm256_and_si256(_mm256_srli_epi32(px, 8), byte), 4);
+            __m256 B = _mm256_i32gather_ps(tables.unit, _mm256_and_si256(_mm256_srli_epi32(px, 16), byte), 4);
+            
+            __m256 V = _mm256_max_ps(R, _mm256_max_ps(G, B));
+            __m256 C = _mm256_sub_ps(V, _mm256_min_ps(R, _mm256_min_ps(G, B)));
+            __m256 L = _mm256_sub_ps(V, _mm256_mul_ps(C, half));
+            
+            __m256 SL = _mm256_div_ps(_mm256_sub_ps(V, L), _mm256_min_ps(L, _mm256_sub_ps(one, L)));
+            __m256 grey = _mm256_or_ps(_mm256_cmp_ps(L, zero, _CMP_EQ_OQ), _mm256_cmp_ps(L, one, _CMP_EQ_OQ));
+            SL = _mm256_andnot_ps(grey, SL);
+            
+            __m128 H_lo = hue_avx2(_mm256_castps256_ps128(R), _mm256_castps256_ps128(G), _mm256_castps256_ps128(B),
+                                   _mm256_castps256_ps128(V), _mm256_castps256_ps128(C));
+            __m128 H_hi = hue_avx2(_mm256_extractf128_ps(R, 1), _mm256_extractf128_ps(G, 1), _mm256_extractf128_ps(B, 1),
+                                   _mm256_extractf128_ps(V, 1), _mm256_extractf128_ps(C, 1));
+            
+            _mm256_storeu_ps(x + p, _mm256_set_m128(H_hi, H_lo));
+            _mm256_storeu_ps(y + p, SL);
+            _mm256_storeu_ps(z + p, L);
+        }
+        
+        hsl_scalar(rgba + 4*p, n - p, x + p, y + p, z + p);
+    }
+#endif
+    
+    BatchFunction select(std::string & name) {
+#ifdef COLORSPACE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            name = "avx2";
+            return hsl_avx2;
+        }
+#endif
+        name = "scalar";
+        return hsl_scalar;
+    }
+    
+    std::string path_name;
+    const BatchFunction hsl_function = select(path_name);
+    
+    std::mutex table_mutex;
+    std::weak_ptr<const std::vector<float>> shared_tables[4];
+}
+
+ColorSpace::ColorSpace() {
+    space = HSL;
+}
+
+// Space named 'name' (hsl, ycbcr, rgb or lab), false if unknown
+bool ColorSpace::parse(std::string name, Space & s) {
+    for (Space candidate : {HSL, YCBCR, RGB, LAB}) {
+        if (name.compare(getName(candidate)) == 0) {
+            s = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ColorSpace::getName(Space s) {
+    switch (s) {
+        case HSL: return "hsl";
+        case YCBCR: return "ycbcr";
+        case RGB: return "rgb";
+        case LAB: return "lab";
+    }
+    return "";
+}
+
+// Space of the conversions, with or without the table of every color
+void ColorSpace::setSpace(Space s, bool use_table) {
+    space = s;
+    table = use_table ? getTable(space) : nullptr;
+}
+
+ColorSpace::Space ColorSpace::getSpace() const {
+    return space;
+}
+
+// Convert n RGBA pixels into the planes x, y, z
+void ColorSpace::convert(const sf::Uint8* rgba, int n, float* x, float* y, float* z) const {
+    if (table) {
+        const float* t = table->data();
+        for (int p = 0; p < n; p++) {
+            const float* v = t + 3 * ((rgba[4*p] << 16) | (rgba[4*p+1] << 8) | rgba[4*p+2]);
+            x[p] = v[0];
+            y[p] = v[1];
+            z[p] = v[2];
+        }
+        return;
+    }
+    
+    switch (space) {
+        case HSL:
+            hsl_function(rgba, n, x, y, z);
+            break;
+            
+        case YCBCR:
+            for (int p = 0; p < n; p++) {
+                int r = rgba[4*p], g = rgba[4*p+1], b = rgba[4*p+2];
+                x[p] = tables.y[0][r] + tables.y[1][g] + tables.y[2][b];
+                y[p] = 128. - tables.cb[0][r] - tables.cb[1][g] + tables.cb[2][b];
+                z[p] = 128. + tables.cr[0][r] - tables.cr[1][g] - tables.cr[2][b];
+            }
+            break;
+            
+        case RGB:
+            for (int p = 0; p < n; p++) {
+                x[p] = tables.unit[rgba[4*p]];
+                y[p] = tables.unit[rgba[4*p+1]];
+                z[p] = tables.unit[rgba[4*p+2]];
+            }
+            break;
+            
+        case LAB:
+            for (int p = 0; p < n; p++) {
+                Vector3 v = lab(rgba[4*p], rgba[4*p+1], rgba[4*p+2]);
+                x[p] = v.x;
+                y[p] = v.y;
+                z[p] = v.z;
+            }
+            break;
+    }
+}
+
+void ColorSpace::convert(const sf::Uint8* rgba, int n, Vector3Array & values) const {
+    values.resize(n);
+    convert(rgba, n, values.x.data(), values.y.data(), values.z.data());
+}
+
+// Per-pixel conversion, the reference of the batches
+Vector3 ColorSpace::convert(Space s, sf::Color col) {
+    switch (s) {
+        case HSL: return RGBtoHSL(col);
+        case YCBCR: return RGBtoYCbCr(col);
+        case RGB: return Vector3(tables.unit[col.r], tables.unit[col.g], tables.unit[col.b]);
+        case LAB: return RGBtoLab(col);
+    }
+    return Vector3();
+}
+
+// Instruction set of the HSL batches
+std::string ColorSpace::getPath() {
+    return path_name;
+}
+
+Vector3 ColorSpace::RGBtoYCbCr(sf::Color col) {
+    float Y = 0.299 * float(col.r) + 0.587 * float(col.g) + 0.114 * float(col.b);
+    float Cb = 128. - 0.1687 * float(col.r) - 0.3313 * float(col.g) + 0.5 * float(col.b);
+    float Cr = 128. + 0.5 * float(col.r) - 0.4187 * float(col.g) - 0.0813 * float(col.b);
+    
+    return Vector3(Y, Cb, Cr);
+}
+
+Vector3 ColorSpace::RGBtoHSL(sf::Color col) {
+    // Normalize RGB values
+    float R = float(col.r)/255., G = float(col.g)/255., B = float(col.b)/255.;
+    
+    // Intermediate variables
+    float V = maximum(R, maximum(G, B));
+    float C = V - minimum(R, minimum(G, B));
+    
+    // Compute H, SL, H
+    float L = V - C/2;
+    
+    float H = 0.;
+    if (C == 0)
+        H = 0;
+    else if (V == R)
+        H = 60. * (G - B) / C;
+    else if (V == G)
+        H = 60. * ( 2. + (B - R) / C );
+    else if (V == B)
+        H = 60. * ( 4. + (R - G) / C );
+    
+    float SL = 0.;
+    if (L == 0. || L == 1.)
+        SL = 0.;
+    else
+        SL = (V - L)/minimum(L, 1. - L);
+    
+    return Vector3(H/360., SL, L);
+}
+
+// L in [0, 100], a and b roughly in [-128, 128] (D65 white)
+Vector3 ColorSpace::RGBtoLab(sf::Color col) {
+    return lab(col.r, col.g, col.b);
+}
+
+// Table of every 24-bit color, built once by all the hardware threads and shared
+std::shared_ptr<const std::vector<float>> ColorSpace::getTable(Space s) {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    
+    std::shared_ptr<const std::vector<float>> shared = shared_tables[s].lock();
+    if (shared)
+        return shared;
+    
+    std::shared_ptr<std::vector<float>> built = std::make_shared<std::vector<float>>(std::size_t(3) << 24);
+    int n_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int r = t; r < 256; r += n_threads) {
+                for (int g = 0; g < 256; g++) {
+                    for (int b = 0; b < 256; b++) {
+                        Vector3 v = convert(s, sf::Color(r, g, b));
+                        float* dst = built->data() + 3 * ((r << 16) | (g << 8) | b);
+                        dst[0] = v.x;
+                        dst[1] = v.y;
+                        dst[2] = v.z;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    
+    shared_tables[s] = built;
+    return built;
+}
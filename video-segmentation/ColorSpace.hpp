@@ -0,0 +1,57 @@
+//
+//  ColorSpace.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef ColorSpace_hpp
+#define ColorSpace_hpp
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cmath>
+
+#include <SFML/Graphics.hpp>
+
+#include "LinearAlgebra.hpp"
+
+// Conversion of RGBA pixels to the color space the densities are estimated in
+// Batches of pixels are converted into structure-of-arrays planes: HSL by 8 pixels (AVX2) and
+// YCbCr/RGB/Lab with per-channel tables, all bit-identical to the per-pixel conversion.
+// Optionally every 24-bit color is converted once into a shared table (2^24 x 3 floats, 192 MB)
+// and a pixel costs a single lookup, which pays off for Lab.
+class ColorSpace {
+public:
+    enum Space { HSL, YCBCR, RGB, LAB };
+    
+    ColorSpace();
+    
+    static bool parse(std::string, Space &);
+    static std::string getName(Space);
+    
+    void setSpace(Space, bool);
+    Space getSpace() const;
+    
+    void convert(const sf::Uint8*, int, float*, float*, float*) const;
+    void convert(const sf::Uint8*, int, Vector3Array &) const;
+    
+    static Vector3 convert(Space, sf::Color);
+    static std::string getPath();
+    
+private:
+    static Vector3 RGBtoHSL(sf::Color);
+    static Vector3 RGBtoYCbCr(sf::Color);
+    static Vector3 RGBtoLab(sf::Color);
+    
+    static std::shared_ptr<const std::vector<float>> getTable(Space);
+    
+    Space space;
+    std::shared_ptr<const std::vector<float>> table; // Every 24-bit color, when enabled
+};
+
+#endif /* ColorSpace_hpp */
@@ -0,0 +1,258 @@
+//
+//  CompactTensor.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "CompactTensor.hpp"
+
+CompactTensor::CompactTensor() {
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    format = FLOAT32;
+    planes = 0;
+    row_words = 0;
+}
+
+bool CompactTensor::parse(std::string name, Format & f) {
+    if (name == "float")
+        f = FLOAT32;
+    else if (name == "half")
+        f = FLOAT16;
+    else if (name == "log8")
+        f = LOG8;
+    else if (name == "bits")
+        f = BITPLANE;
+    else
+        return false;
+    return true;
+}
+
+std::string CompactTensor::getName(Format f) {
+    switch (f) {
+        case FLOAT16: return "half";
+        case LOG8: return "log8";
+        case BITPLANE: return "bits";
+        default: return "float";
+    }
+}
+
+// N frames of WIDTH x HEIGHT, 'presets' being the thresholds kept by BITPLANE
+void CompactTensor::create(int n, int width, int height, Format f, const std::vector<float> & presets) {
+    N = n;
+    WIDTH = width;
+    HEIGHT = height;
+    format = f;
+    
+    std::size_t count = std::size_t(N) * WIDTH * HEIGHT;
+    halfs.assign(format == FLOAT16 ? count : 0, 0);
+    bytes.assign(format == LOG8 ? count : 0, 0);
+    bounds.clear();
+    
+    if (format == LOG8)
+        for (int c = 0; c < 255; c++)
+            bounds.push_back(expf(LOG_MIN + LOG_STEP * (c + 1)));
+    
+    planes = 0;
+    row_words = 0;
+    if (format == BITPLANE) {
+        bounds = presets;
+        std::sort(bounds.begin(), bounds.end());
+        bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+        while ((1 << planes) < int(bounds.size()) + 1)
+            planes++;
+        row_words = (WIDTH + 63) / 64;
+    }
+    bits.assign(std::size_t(N) * planes * HEIGHT * row_words, 0);
+    
+    values = bounds;
+    values.push_back(INFINITY);
+}
+
+CompactTensor::Format CompactTensor::getFormat() {
+    return format;
+}
+
+std::size_t CompactTensor::getBytes() {
+    return halfs.size() * sizeof(std::uint16_t) + bytes.size() + bits.size() * sizeof(std::uint64_t);
+}
+
+// Encode the rows [j0, j0 + rows) of the frame k, 'src' pointing to the first of them
+// Different frames, or different rows, can be encoded at the same time
+void CompactTensor::encode(int k, int j0, int rows, const float* src) {
+    std::size_t offset = (std::size_t(k) * HEIGHT + j0) * WIDTH, count = std::size_t(rows) * WIDTH;
+    
+    if (format == FLOAT16) {
+        for (std::size_t p = 0; p < count; p++)
+            halfs[offset + p] = toLogHalf(src[p]);
+    } else if (format == LOG8) {
+        for (std::size_t p = 0; p < count; p++)
+            bytes[offset + p] = (std::uint8_t) getCode(src[p]);
+    } else if (format == BITPLANE) {
+        for (int j = 0; j < rows; j++) {
+            for (int b = 0; b < planes; b++)
+                std::fill_n(&bits[((std::size_t(k) * planes + b) * HEIGHT + j0 + j) * row_words], row_words, 0);
+            
+            for (int i = 0; i < WIDTH; i++) {
+                int code = getCode(src[std::size_t(j) * WIDTH + i]);
+                for (int b = 0; b < planes; b++)
+                    if (code & (1 << b))
+                        bits[((std::size_t(k) * planes + b) * HEIGHT + j0 + j) * row_words + i / 64] |= std::uint64_t(1) << (i % 64);
+            }
+        }
+    }
+}
+
+// Densities the codes of the frame k stand for
+void CompactTensor::decode(int k, float* dst) {
+    std::size_t offset = std::size_t(k) * WIDTH * HEIGHT, count = std::size_t(WIDTH) * HEIGHT;
+    
+    if (format == FLOAT16) {
+        for (std::size_t p = 0; p < count; p++)
+            dst[p] = fromLogHalf(halfs[offset + p]);
+    } else if (format == LOG8) {
+        for (std::size_t p = 0; p < count; p++)
+            dst[p] = values[bytes[offset + p]];
+    } else if (format == BITPLANE) {
+        for (int j = 0; j < HEIGHT; j++) {
+            for (int i = 0; i < WIDTH; i++) {
+                int code = 0;
+                for (int b = 0; b < planes; b++)
+                    code |= int((bits[((std::size_t(k) * planes + b) * HEIGHT + j) * row_words + i / 64] >> (i % 64)) & 1) << b;
+                dst[std::size_t(j) * WIDTH + i] = values[code];
+            }
+        }
+    }
+}
+
+// Largest density a code stands for below the threshold s, -1 when there is none
+float CompactTensor::snap(float s) {
+    int t = getThreshold(s);
+    if (t < 0)
+        return -1.f;
+    return format == FLOAT16 ? fromLogHalf((std::uint16_t) t) : values[t];
+}
+
+// RGBA mask of the frame k, the thresholds being snapped ones
+const sf::Uint8* CompactTensor::extract(int k, float s, float s2, MaskExtractor & extractor) {
+    int t = getThreshold(s), t2 = getThreshold(s2);
+    std::size_t offset = std::size_t(k) * WIDTH * HEIGHT;
+    
+    if (format == FLOAT16) {
+        const std::uint16_t* frame = &halfs[offset];
+        return extractor.extract([&](int j) { return frame + std::size_t(j) * WIDTH; }, t, t2);
+    }
+    
+    if (format == LOG8) {
+        const std::uint8_t* frame = &bytes[offset];
+        return extractor.extract([&](int j) { return frame + std::size_t(j) * WIDTH; }, t, t2);
+    }
+    
+    // The levels of a row are gathered from its bit planes
+    row.resize(WIDTH);
+    return extractor.extract([&](int j) {
+        std::fill(row.begin(), row.end(), 0);
+        for (int b = 0; b < planes; b++) {
+            const std::uint64_t* plane = &bits[((std::size_t(k) * planes + b) * HEIGHT + j) * row_words];
+            for (int i = 0; i < WIDTH; i++)
+                row[i] |= std::uint8_t(((plane[i / 64] >> (i % 64)) & 1) << b);
+        }
+        return (const std::uint8_t*) row.data();
+    }, t, t2);
+}
+
+// Number of bounds below the density, NaN going to the last code as it is never foreground
+int CompactTensor::getCode(float d) {
+    if (std::isnan(d))
+        return (int) bounds.size();
+    return (int) (std::lower_bound(bounds.begin(), bounds.end(), d) - bounds.begin());
+}
+
+// Largest code whose density is below s: every density below s is encoded at or below it
+// A threshold within SNAP_TOLERANCE of a bound is taken as that bound
+int CompactTensor::getThreshold(float s) {
+    if (std::isnan(s) || s < 0.f)
+        return -1;
+    
+    // The nearest code, then moved to the last one at or below s
+    if (format == FLOAT16) {
+        int h = std::min(toLogHalf(s), LOG_HALF_INF);
+        while (h > LOG_HALF_ZERO && fromLogHalf((std::uint16_t) h) > s)
+            h--;
+        while (h < LOG_HALF_INF && fromLogHalf((std::uint16_t) (h + 1)) <= s)
+            h++;
+        return h;
+    }
+    
+    return int(std::upper_bound(values.begin(), values.end(), s * (1.f + SNAP_TOLERANCE)) - values.begin()) - 1;
+}
+
+// Round to nearest even, with subnormals and infinities
+std::uint16_t CompactTensor::toHalf(float f) {
+    std::uint32_t x;
+    std::memcpy(&x, &f, 4);
+    std::uint32_t sign = (x >> 16) & 0x8000, abs = x & 0x7fffffff;
+    
+    if (abs >= 0x7f800000) // Inf, NaN
+        return std::uint16_t(sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0));
+    if (abs >= 0x477ff000) // Rounds above the largest half
+        return std::uint16_t(sign | 0x7c00);
+    if (abs < 0x33000001) // Rounds to 0
+        return std::uint16_t(sign);
+    
+    int exponent = int(abs >> 23) - 127 + 15;
+    std::uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+    int shift = exponent > 0 ? 13 : 14 - exponent; // Subnormal halves lose more bits
+    std::uint32_t h = mantissa >> shift, rest = mantissa & ((1u << shift) - 1), half = 1u << (shift - 1);
+    if (rest > half || (rest == half && (h & 1)))
+        h++;
+    
+    // A carry out of the mantissa moves to the exponent, which is what the bit layout does by itself
+    if (exponent > 0)
+        h = (std::uint32_t(exponent) << 10) + (h - 0x400);
+    return std::uint16_t(sign | h);
+}
+
+// Half float of log(d) with the bits of the negative ones flipped and the sign bit of the others set,
+// so that the codes increase with d: 0 has the code of -inf, NaN the largest code
+std::uint16_t CompactTensor::toLogHalf(float d) {
+    if (std::isnan(d))
+        return LOG_HALF_NAN;
+    std::uint16_t h = toHalf(logf(std::max(d, 0.f)));
+    return h & 0x8000 ? std::uint16_t(~h) : std::uint16_t(h | 0x8000);
+}
+
+float CompactTensor::fromLogHalf(std::uint16_t code) {
+    if (code == LOG_HALF_NAN)
+        return NAN;
+    std::uint16_t h = code & 0x8000 ? std::uint16_t(code & 0x7fff) : std::uint16_t(~code);
+    return expf(fromHalf(h));
+}
+
+float CompactTensor::fromHalf(std::uint16_t h) {
+    std::uint32_t sign = std::uint32_t(h & 0x8000) << 16, exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+    std::uint32_t x;
+    
+    if (exponent == 0x1f)
+        x = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent > 0)
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    else if (mantissa == 0)
+        x = sign;
+    else {
+        // Subnormal: normalize the mantissa
+        int e = -1;
+        do {
+            e++;
+            mantissa <<= 1;
+        } while (!(mantissa & 0x400));
+        x = sign | (std::uint32_t(127 - 15 - e) << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    
+    float f;
+    std::memcpy(&f, &x, 4);
+    return f;
+}
@@ -0,0 +1,81 @@
+//
+//  CompactTensor.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef CompactTensor_hpp
+#define CompactTensor_hpp
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <SFML/Graphics.hpp>
+
+#include "MaskExtractor.hpp"
+
+// Frame major density tensor stored as codes instead of floats
+// FLOAT16 keeps the log of the densities as IEEE half floats (2 bytes), whose bits are reordered
+// so that the codes sort like the densities: the densities are rounded by less than 0.4% down to
+// e^-16 and 0.8% down to e^-32, instead of raw halves going subnormal below 6e-5. LOG8 quantizes their log on a grid
+// of 0.1 from -25.5 to 0 (1 byte), so that the thresholds of the viewer and of the command
+// line, which move on that grid, give the masks of the float densities. BITPLANE only keeps,
+// for a few preset thresholds, whether each pixel is below them: one bit per preset rounded up
+// to a power of two levels (2 bits for the two thresholds of a batch run).
+// Every code stands for a density: the exponential of the half float, the upper bound of the log bin, the preset.
+// A threshold is snapped to the largest of them below it, after which comparing the codes gives
+// exactly the mask of the decoded densities.
+class CompactTensor {
+public:
+    enum Format { FLOAT32, FLOAT16, LOG8, BITPLANE };
+    
+    CompactTensor();
+    
+    static bool parse(std::string, Format &);
+    static std::string getName(Format);
+    
+    void create(int, int, int, Format, const std::vector<float> &);
+    Format getFormat();
+    std::size_t getBytes();
+    
+    void encode(int, int, int, const float*);
+    void decode(int, float*);
+    
+    float snap(float);
+    const sf::Uint8* extract(int, float, float, MaskExtractor &);
+    
+private:
+    int getCode(float);
+    int getThreshold(float);
+    
+    static std::uint16_t toHalf(float);
+    static float fromHalf(std::uint16_t);
+    static std::uint16_t toLogHalf(float);
+    static float fromLogHalf(std::uint16_t);
+    
+    static constexpr float LOG_MIN = -25.5f, LOG_STEP = 0.1f;
+    static constexpr float SNAP_TOLERANCE = 1e-4f; // Relative, for the thresholds computed from their log
+    static constexpr std::uint16_t LOG_HALF_ZERO = 0x03ff, LOG_HALF_INF = 0xfc00, LOG_HALF_NAN = 0xffff; // FLOAT16 codes
+    
+    int N, WIDTH, HEIGHT;
+    Format format;
+    
+    std::vector<std::uint16_t> halfs; // FLOAT16
+    std::vector<std::uint8_t> bytes;  // LOG8
+    std::vector<std::uint64_t> bits;  // BITPLANE: 'planes' bit planes per frame, rows padded to 64 bits
+    int planes;
+    std::size_t row_words;
+    
+    std::vector<float> bounds; // Code c holds the densities in (bounds[c-1], bounds[c]]
+    std::vector<float> values; // Density of each code, bounds[c] and +inf for the last one
+    
+    std::vector<std::uint8_t> row; // Levels of a BITPLANE row
+};
+
+#endif /* CompactTensor_hpp */
@@ -8,167 +8,936 @@
 
 #include "DPEstimator.hpp"
 
-// Helper functions
-float max(float, float, float);
-float max(float, float);
-float min(float, float, float);
-float min(float, float);
+#include <unistd.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
 
 // DPEstimator member functions
 DPEstimator::DPEstimator() {
+    layout = DensityTensor::FRAME_MAJOR;
+    kde_tolerance = 0.;
+    forgetting = 1.;
+    index_frame = -1;
+    last_frame = -1;
+    last_indexed = false;
+    statistics = nullptr;
+    spill_budget = 0;
+    storage = CompactTensor::FLOAT32;
+    storage_budget = 0;
+    smoothness = 0.;
+    window = 0;
+    gmm_components = 3;
+    gmm_covariance = GMMEstimator::DIAGONAL;
+    pyramid = 1;
+    refine_budget = 0.25;
+    ordered = false;
+    priority = nullptr;
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    fitting = false;
+    cancelled = false;
+    fitted_pixels = 0;
+    CELLS_X = 0;
+}
+
+DPEstimator::~DPEstimator() {
+    cancelled = true;
+    wait();
+}
+
+// Layout used by evaluate, the tensor is transposed after the fit when it is FRAME_MAJOR
+void DPEstimator::setLayout(DensityTensor::Layout l) {
+    layout = l;
+}
+
+// Threads used by the fit, 0 for every hardware thread
+void DPEstimator::setThreads(int n) {
+    scheduler.setThreads(n);
+    potts.setThreads(n);
+}
+
+// Error bound on each kernel term of the KDE, 0 for the exact estimator
+void DPEstimator::setKDETolerance(float eps) {
+    kde_tolerance = eps;
+}
+
+// Space the densities are estimated in, 'table' converts through the table of every color
+void DPEstimator::setColorSpace(ColorSpace::Space space, bool table) {
+    colorspace.setSpace(space, table);
+}
+
+// Forgetting factor of the online estimator, 1 without forgetting
+void DPEstimator::setForgetting(float lambda) {
+    forgetting = lambda;
+}
+
+// Directory of the density cache, disabled when empty
+void DPEstimator::setCache(std::string directory) {
+    cache.setDirectory(directory);
+}
+
+// Components of the GMM and their covariance
+void DPEstimator::setGMM(int components, GMMEstimator::Covariance covariance) {
+    gmm_components = components;
+    gmm_covariance = covariance;
+}
+
+// Frames the MLE and KDE densities of a frame are estimated from, 0 for the whole sequence
+void DPEstimator::setWindow(int w) {
+    window = w;
+}
+
+// Out-of-core fitting: the densities are written by bands of rows to a file of 'directory' and
+// mapped, the bands holding at most 'budget' bytes of densities in memory. Disabled when empty.
+void DPEstimator::setSpill(std::string directory, std::size_t budget) {
+    spill_path = directory;
+    spill_budget = budget;
+    
+    std::error_code error;
+    if (!spill_path.empty())
+        fs::create_directories(spill_path, error);
+}
+
+// Compact storage of the densities: the fit goes by bands of rows of at most 'budget' bytes of
+// densities, which are encoded as soon as they are fitted. 'presets' are the thresholds kept by
+// BITPLANE. The float tensor, and the spill file, are then never allocated.
+void DPEstimator::setStorage(CompactTensor::Format format, const std::vector<float> & presets, std::size_t budget) {
+    storage = format;
+    storage_presets = presets;
+    storage_budget = budget;
+}
+
+// Masks regularized by a Potts model of weight 'beta', within 'budget' milliseconds a frame,
+// 0 for the hysteresis masks
+void DPEstimator::setSmoothness(float beta, float budget) {
+    smoothness = beta;
+    potts.setSmoothness(beta);
+    potts.setBudget(budget);
+}
+
+// Pyramid fit: the densities are first fitted at one pixel of each 'factor' x 'factor' block, then
+// at full resolution for at most the fraction 'budget' of the other pixels, those of the blocks whose
+// densities are near the 'thresholds' or differ from their neighbours' the most often. The other
+// pixels take the densities of their block. A factor of 1 fits every pixel.
+void DPEstimator::setPyramid(int factor, float budget, const std::vector<float> & thresholds) {
+    pyramid = std::max(1, factor);
+    refine_budget = std::min(1.f, std::max(0.f, budget));
+    pyramid_thresholds = thresholds;
+}
+
+// Tiles fitted in order of priority: the most varying ones according to 'stats' first, or without
+// statistics the ones nearest to the center. Only shows in the masks evaluated while fitting.
+void DPEstimator::setPriority(bool enabled, PixelStatistics* stats) {
+    ordered = enabled;
+    priority = stats;
+}
+
+// Statistics of the imageset the MLE uses instead of its own mean and covariance, when they are in its color space
+void DPEstimator::setStatistics(PixelStatistics* stats) {
+    statistics = stats;
+}
+
+void DPEstimator::fit(FrameStore & frames, std::string method) {
+    begin(frames);
+    fitTensor(frames, method);
+}
+
+// Fit in a background thread, evaluate() giving the masks of the tiles fitted so far meanwhile.
+// The frames must outlive the fit.
+void DPEstimator::start(FrameStore & frames, std::string method) {
+    wait();
+    begin(frames);
+    fit_thread = std::thread([this, &frames, method]() { fitTensor(frames, method); });
+}
+
+// Wait for the fit started in the background
+void DPEstimator::wait() {
+    if (fit_thread.joinable())
+        fit_thread.join();
+}
+
+bool DPEstimator::isFitting() {
+    return fitting;
+}
+
+// Fraction of the pixels whose densities can be evaluated, 1 once the fit is over
+float DPEstimator::getProgress() {
+    if (!fitting)
+        return 1.;
+    return (float) fitted_pixels / std::max(1, WIDTH * HEIGHT);
+}
+
+// Dimensions of the tensor, and no pixel fitted yet
+void DPEstimator::begin(FrameStore & frames) {
+    std::unique_lock<std::shared_mutex> lock(density_mutex);
+    N = frames.size();
+    WIDTH = frames.getSize().x;
+    HEIGHT = frames.getSize().y;
+    index_frame = -1;
+    last_frame = -1;
     
+    CELLS_X = (WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    int cells_y = (HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+    cell_pixels = std::vector<std::atomic<int>>(std::size_t(CELLS_X) * cells_y);
+    for (auto & count : cell_pixels)
+        count = 0;
+    fitted_pixels = 0;
+    cancelled = false;
+    fitting = true;
 }
 
-void DPEstimator::fit(const std::vector<std::string> & imageset, std::string method) {
-    // Get the tensor dimensions
-    sf::Image image_info;
-    image_info.loadFromFile(imageset[0]);
-    N = (int) imageset.size();
-    WIDTH = image_info.getSize().x;
-    HEIGHT = image_info.getSize().y;
+// The fit ends under the lock that gives the tensor its final layout, on every path
+void DPEstimator::fitTensor(FrameStore & frames, std::string method) {
+    // Map the densities of a previous run
+    int cached = 0;
+    if (cache.isEnabled()) {
+        std::vector<std::string> identities(N);
+        for (int k = 0; k < N; k++)
+            identities[k] = frames.getIdentity(k);
+        cache.setKey(frames.getPath(), identities, WIDTH, HEIGHT, getSignature(method));
+        cached = cache.load(tensorDensity);
+    }
     
-    // Initialize the tensor
-    tensorDensity = std::vector<std::vector<std::vector<float>>>(WIDTH, std::vector<std::vector<float>>(HEIGHT, std::vector<float>(N, 0.)));
+    if (cached > 0 && cached == N) {
+        Profiler::count(Profiler::CACHE_HIT);
+        std::unique_lock<std::shared_mutex> lock(density_mutex);
+        fitting = false;
+        if (storage != CompactTensor::FLOAT32) {
+            compactDensity.create(N, WIDTH, HEIGHT, storage, storage_presets);
+            tensorDensity.transpose(DensityTensor::FRAME_MAJOR);
+            scheduler.run(N, 1, 1, [&](const TileScheduler::Tile & tile, int) {
+                compactDensity.encode(tile.x0, 0, HEIGHT, tensorDensity.getFrame(tile.x0));
+            });
+            tensorDensity.create(0, 0, 0, DensityTensor::PIXEL_MAJOR, 0.);
+            return;
+        }
+        tensorDensity.transpose(layout);
+        return;
+    }
     
-    // Fit the estimator
+    // Fit the estimator, the tensor is PIXEL_MAJOR while fitting each timepixel, FRAME_MAJOR for the online estimator
+    // Only the online estimator can extend cached densities: the others depend on every frame
+    std::vector<float> state;
+    scratch = std::vector<Scratch>(scheduler.getThreads());
     if (!method.compare("mle")) {
-        fit_mle(imageset);
+        createTensor(frames, method);
+        fit_mle(frames);
     } else if (!method.compare("kde")) {
-        fit_kde(imageset);
+        createTensor(frames, method);
+        fit_kde(frames);
+    } else if (!method.compare("gmm")) {
+        createTensor(frames, method);
+        fit_gmm(frames);
+    } else if (!method.compare("online")) {
+        fit_online(frames, cached, state);
     } else {
+        scratch.clear();
         std::cout << "ERROR: unknown method : " << method << "\n";
+        std::unique_lock<std::shared_mutex> lock(density_mutex);
+        tensorDensity.create(N, WIDTH, HEIGHT, DensityTensor::PIXEL_MAJOR, 0.);
+        fitting = false;
+        return;
     }
+    scratch.clear();
+    
+    // The densities fitted so far are being evaluated until the tensor takes its final layout, the
+    // evaluations then read it as it is
+    std::unique_lock<std::shared_mutex> lock(density_mutex);
+    fitting = false;
+    
+    if (storage != CompactTensor::FLOAT32) {
+        std::cout << "INFO: Densities stored as " << CompactTensor::getName(storage) << " (" << compactDensity.getBytes() / (1024*1024) << " MB)\n";
+        return;
+    }
+    
+    // A spilled tensor stays on disk, banded
+    if (!spill_path.empty())
+        tensorDensity.closeFile();
+    tensorDensity.transpose(layout);
+    
+    // Saved while the densities are evaluated, which only read them
+    lock.unlock();
+    if (cache.isEnabled() && !cancelled && tensorDensity.getLayout() != DensityTensor::BAND_MAJOR)
+        cache.save(tensorDensity, state);
 }
 
-sf::Image DPEstimator::evaluate(int k, float s, float s2) {
-    sf::Image image_density;
-    image_density.create(WIDTH, HEIGHT, sf::Color::Transparent);
+// RGBA mask of the frame k, valid until the next call
+// A frame evaluated twice in a row gets a threshold index up to a few steps above s2,
+// so that the following threshold changes are answered without rescanning the frame
+const sf::Uint8* DPEstimator::evaluate(int k, float s, float s2) {
+    Profiler::Scope scope(Profiler::EVALUATE, (long long) WIDTH * HEIGHT);
+    std::shared_lock<std::shared_mutex> lock(density_mutex);
+    
+    // While fitting, the mask of the densities fitted so far, without the index
+    if (fitting) {
+        last_frame = -1;
+        last_indexed = false;
+        const float* density = getPartialFrame(k, plane, s, s2);
+        if (smoothness > 0.) {
+            potts.create(WIDTH, HEIGHT);
+            return potts.segment(density, s, s2, extractor);
+        }
+        extractor.create(WIDTH, HEIGHT);
+        return extractor.extract(density, s, s2);
+    }
+    
+    // Compact densities: the thresholds are snapped to densities the codes stand for, so that
+    // the index over the decoded frame and the extraction on the codes give the same masks
+    bool compact = storage != CompactTensor::FLOAT32;
+    if (compact) {
+        s = compactDensity.snap(s);
+        s2 = compactDensity.snap(s2);
+    }
     
-    for (int i = 0; i < WIDTH; i++)
-        for (int j = 0; j < HEIGHT; j++)
-            if (tensorDensity[i][j][k] <= s)
-                spread(image_density, k, i, j, s2);
+    // The regularized mask depends on every pixel of the plane, the index does not help
+    if (smoothness > 0.) {
+        last_frame = k;
+        last_indexed = false;
+        potts.create(WIDTH, HEIGHT);
+        if (compact) {
+            plane.resize(std::size_t(WIDTH) * HEIGHT);
+            compactDensity.decode(k, plane.data());
+            return potts.segment(plane.data(), s, s2, extractor);
+        }
+        return potts.segment(tensorDensity.getFrame(k, plane), s, s2, extractor);
+    }
+    
+    bool indexed = s <= s2 && (index_frame == k || last_frame == k);
+    last_frame = k;
+    
+    if (indexed && (index_frame != k || s2 > index.getLevelMax())) {
+        Profiler::count(Profiler::INDEX_BUILD);
+        if (compact) {
+            plane.resize(std::size_t(WIDTH) * HEIGHT);
+            compactDensity.decode(k, plane.data());
+        }
+        index.build(compact ? plane.data() : tensorDensity.getFrame(k, plane), WIDTH, HEIGHT, s2 * INDEX_MARGIN);
+        index_frame = k;
+    }
+    last_indexed = indexed;
+    
+    if (indexed)
+        return index.query(s, s2);
     
-    return image_density;
+    extractor.create(WIDTH, HEIGHT);
+    if (compact)
+        return compactDensity.extract(k, s, s2, extractor);
+    return extractor.extract(tensorDensity.getFrame(k, plane), s, s2);
 }
 
-void DPEstimator::spread(sf::Image & image, int k, int i, int j, float s) {
-    if (image.getPixel(i, j) != sf::Color::Red) {
-        image.setPixel(i, j, sf::Color::Red);
+// Mask of evaluate(k, s, s2) in the buffers of 'evaluation', without the index: the densities are
+// only read, so that other threads can evaluate frames meanwhile
+const sf::Uint8* DPEstimator::evaluate(int k, float s, float s2, Evaluation & evaluation) {
+    Profiler::Scope scope(Profiler::EVALUATE, (long long) WIDTH * HEIGHT);
+    std::shared_lock<std::shared_mutex> lock(density_mutex);
+    
+    // The decoded codes are below the snapped thresholds exactly when the codes are below theirs
+    const float* density;
+    if (fitting)
+        density = getPartialFrame(k, evaluation.plane, s, s2);
+    else if (storage != CompactTensor::FLOAT32) {
+        s = compactDensity.snap(s);
+        s2 = compactDensity.snap(s2);
+        evaluation.plane.resize(std::size_t(WIDTH) * HEIGHT);
+        compactDensity.decode(k, evaluation.plane.data());
+        density = evaluation.plane.data();
+    } else
+        density = tensorDensity.getFrame(k, evaluation.plane);
     
-        if (i-1 >= 0 && tensorDensity[i-1][j][k] <= s)
-            spread(image, k, i-1, j, s);
-        if (i+1 < WIDTH && tensorDensity[i+1][j][k] <= s)
-            spread(image, k, i+1, j, s);
-        if (j-1 >= 0 && tensorDensity[i][j-1][k] <= s)
-            spread(image, k, i, j-1, s);
-        if (j+1 < HEIGHT && tensorDensity[i][j+1][k] <= s)
-            spread(image, k, i, j+1, s);
+    if (evaluation.smoothness > 0.) {
+        evaluation.potts.create(WIDTH, HEIGHT);
+        evaluation.potts.setThreads(scheduler.getThreads());
+        evaluation.potts.setSmoothness(evaluation.smoothness);
+        evaluation.potts.setBudget(evaluation.smoothing_budget);
+        return evaluation.potts.segment(density, s, s2, evaluation.extractor);
     }
+    
+    evaluation.extractor.create(WIDTH, HEIGHT);
+    return evaluation.extractor.extract(density, s, s2);
 }
 
-void DPEstimator::fit_mle(const std::vector<std::string> & imageset) {
-    // Load temporary the images in the RAM for faster computation
-    std::vector<sf::Image> tensorPixel = std::vector<sf::Image>(N, sf::Image());
-    for (int k = 0; k < N; k++)
-        tensorPixel[k].loadFromFile(imageset[k]);
+// Foreground components of the last evaluated mask
+const std::vector<MaskExtractor::Component> & DPEstimator::getComponents() {
+    if (last_indexed)
+        return index.getComponents();
+    else
+        return extractor.getComponents();
+}
+
+void DPEstimator::fit_mle(FrameStore & frames) {
+    bool reuse = reuseStatistics();
+    int w = getWindow();
+    
+    // The frames are read by bands of rows, the whole image at once when the imageset is resident
+    std::vector<sf::Uint8> band;
+    int band_rows = getBandRows(frames);
+    Progress progress("mle", getFitPixels(band_rows));
     
-    // Estimate the pixel density for each 'timepixel'
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
-            // Load the timepixel
-            std::vector<Vector3> timePixel(N, Vector3::Zeros());
-            for (int k = 0; k < N; k++)
-                timePixel[k] = RGBtoHSL(tensorPixel[k].getPixel(i, j));
+    for (int j0 = 0; j0 < HEIGHT; j0 += band_rows) {
+        int rows = std::min(band_rows, HEIGHT - j0);
+        std::vector<const sf::Uint8*> tensorPixel = frames.getRows(j0, rows, band);
+        beginBand(rows);
+        
+        // Estimate the pixel density for each 'timepixel', tiles are independent
+        fitTiles(j0, rows, progress, [&](const TileScheduler::Tile & tile, Scratch & scratch) {
+            int tile_width = tile.x1 - tile.x0, tile_pixels = tile_width * (tile.y1 - tile.y0);
+            Profiler::Scope scope(Profiler::FIT, (long long) N * getSelected(tile));
             
-            // Fit the ML estimator
-            MLEstimator mlestimator;
-            mlestimator.fit(timePixel);
+            // Convert the tile of every frame at once
+            Vector3Array & values = scratch.values;
+            convertTile(tensorPixel, tile, scratch);
             
-            // Estimate the (proportionnal) density for each pixel
-            tensorDensity[i][j] = mlestimator.evaluate(timePixel, false);
-        }
+            for (int i = tile.x0; i < tile.x1; i++) {
+                for (int j = j0 + tile.y0; j < j0 + tile.y1; j++) {
+                    if (!isSelected(i, j, j0))
+                        continue;
+                    
+                    // Load the timepixel
+                    int p = (j - j0 - tile.y0) * tile_width + (i - tile.x0);
+                    Vector3Array & timePixel = scratch.timePixel;
+                    timePixel.resize(N);
+                    for (int k = 0; k < N; k++)
+                        timePixel.set(k, values.get(k * tile_pixels + p));
+                    
+                    // Fit the ML estimator, or the one of each window
+                    MLEstimator & mlestimator = scratch.mlestimator;
+                    if (w > 0) {
+                        mlestimator.fit_evaluate(timePixel, w, getDensities(i, j, j0));
+                        continue;
+                    }
+                    if (reuse)
+                        mlestimator.fit(statistics->getMean(i, j), statistics->getCovariance(i, j));
+                    else
+                        mlestimator.fit(timePixel);
+                    
+                    // Estimate the (proportionnal) density for each pixel
+                    mlestimator.evaluate(timePixel, false, getDensities(i, j, j0));
+                }
+            }
+            progress.advance((long long) N * getSelected(tile));
+        });
+        endBand(j0);
     }
+    progress.finish();
 }
 
-void DPEstimator::fit_kde(const std::vector<std::string> & imageset) {
-    // Load temporary the images in the RAM for faster computation
-    std::vector<sf::Image> tensorPixel = std::vector<sf::Image>(N, sf::Image());
-    for (int k = 0; k < N; k++)
-        tensorPixel[k].loadFromFile(imageset[k]);
+void DPEstimator::fit_kde(FrameStore & frames) {
+    // The frames are read by bands of rows, the whole image at once when the imageset is resident
+    std::vector<sf::Uint8> band;
+    int band_rows = getBandRows(frames);
+    
+    Progress progress("kde", getFitPixels(band_rows));
     
-    // Estimate the pixel density for each 'timepixel'
-    for (int i = 0; i < WIDTH; i++) {
-        std::cout << i << " sur " << WIDTH-1 << std::endl;
-        for (int j = 0; j < HEIGHT; j++) {
-            // Load the timepixel
-            std::vector<Vector3> timePixel(N, Vector3::Zeros());
-            for (int k = 0; k < N; k++)
-                timePixel[k] = RGBtoHSL(tensorPixel[k].getPixel(i, j));
+    for (int j0 = 0; j0 < HEIGHT; j0 += band_rows) {
+        int rows = std::min(band_rows, HEIGHT - j0);
+        std::vector<const sf::Uint8*> tensorPixel = frames.getRows(j0, rows, band);
+        beginBand(rows);
+        
+        // Estimate the pixel density for each 'timepixel', tiles are independent
+        fitTiles(j0, rows, progress, [&](const TileScheduler::Tile & tile, Scratch & scratch) {
+            int tile_width = tile.x1 - tile.x0, tile_pixels = tile_width * (tile.y1 - tile.y0);
+            Profiler::Scope scope(Profiler::FIT, (long long) N * getSelected(tile));
             
-            // Fit the KD estimator & estimate the density
-            KDEstimator kdestimator;
-            tensorDensity[i][j] = kdestimator.fit_evaluate(timePixel);
-        }
+            // Convert the tile of every frame at once
+            Vector3Array & values = scratch.values;
+            convertTile(tensorPixel, tile, scratch);
+            
+            for (int i = tile.x0; i < tile.x1; i++) {
+                for (int j = j0 + tile.y0; j < j0 + tile.y1; j++) {
+                    if (!isSelected(i, j, j0))
+                        continue;
+                    
+                    // Load the timepixel
+                    int p = (j - j0 - tile.y0) * tile_width + (i - tile.x0);
+                    Vector3Array & timePixel = scratch.timePixel;
+                    timePixel.resize(N);
+                    for (int k = 0; k < N; k++)
+                        timePixel.set(k, values.get(k * tile_pixels + p));
+                    
+                    // Fit the KD estimator & estimate the density
+                    KDEstimator & kdestimator = scratch.kdestimator;
+                    kdestimator.setTolerance(kde_tolerance);
+                    kdestimator.setWindow(getWindow());
+                    kdestimator.fit_evaluate(timePixel, getDensities(i, j, j0));
+                }
+            }
+            progress.advance((long long) N * getSelected(tile));
+        });
+        endBand(j0);
     }
+    progress.finish();
 }
 
-Vector3 DPEstimator::RGBtoYCbCr(sf::Color col) {
-    float Y = 0.299 * float(col.r) + 0.587 * float(col.g) + 0.114 * float(col.b);
-    float Cb = 128. - 0.1687 * float(col.r) - 0.3313 * float(col.g) + 0.5 * float(col.b);
-    float Cr = 128. + 0.5 * float(col.r) - 0.4187 * float(col.g) - 0.0813 * float(col.b);
+void DPEstimator::fit_gmm(FrameStore & frames) {
+    // The frames are read by bands of rows, the whole image at once when the imageset is resident
+    std::vector<sf::Uint8> band;
+    int band_rows = getBandRows(frames);
     
-    return Vector3(Y, Cb, Cr);
+    Progress progress("gmm", getFitPixels(band_rows));
+    
+    for (int j0 = 0; j0 < HEIGHT; j0 += band_rows) {
+        int rows = std::min(band_rows, HEIGHT - j0);
+        std::vector<const sf::Uint8*> tensorPixel = frames.getRows(j0, rows, band);
+        beginBand(rows);
+        
+        // The pixels of a tile are fitted together, tiles are independent
+        fitTiles(j0, rows, progress, [&](const TileScheduler::Tile & tile, Scratch & scratch) {
+            int tile_width = tile.x1 - tile.x0, tile_pixels = tile_width * (tile.y1 - tile.y0);
+            Profiler::Scope scope(Profiler::FIT, (long long) N * getSelected(tile));
+            
+            // Convert the tile of every frame at once
+            Vector3Array & values = scratch.values;
+            convertTile(tensorPixel, tile, scratch);
+            
+            // Only the selected pixels of a pyramid pass
+            std::vector<int> & pixels = scratch.pixels;
+            pixels.clear();
+            for (int j = j0 + tile.y0; j < j0 + tile.y1; j++)
+                for (int i = tile.x0; i < tile.x1; i++)
+                    if (isSelected(i, j, j0))
+                        pixels.push_back((j - j0 - tile.y0) * tile_width + (i - tile.x0));
+            int count = (int) pixels.size();
+            Vector3Array* samples = &values;
+            if (count < tile_pixels) {
+                scratch.selected.resize(N * count);
+                for (int k = 0; k < N; k++)
+                    for (int q = 0; q < count; q++)
+                        scratch.selected.set(k * count + q, values.get(k * tile_pixels + pixels[q]));
+                samples = &scratch.selected;
+            }
+            
+            GMMEstimator & gmmestimator = scratch.gmmestimator;
+            gmmestimator.setComponents(gmm_components);
+            gmmestimator.setCovariance(gmm_covariance);
+            std::vector<float> & density = scratch.density;
+            density.resize(std::size_t(N) * count);
+            gmmestimator.fit_evaluate(*samples, count, density.data());
+            
+            for (int q = 0; q < count; q++) {
+                int i = tile.x0 + pixels[q] % tile_width, j = j0 + tile.y0 + pixels[q] / tile_width;
+                float* timePixel = getDensities(i, j, j0);
+                for (int k = 0; k < N; k++)
+                    timePixel[k] = density[std::size_t(k) * count + q];
+            }
+            progress.advance((long long) N * getSelected(tile));
+        });
+        endBand(j0);
+    }
+    progress.finish();
 }
 
-Vector3 DPEstimator::RGBtoHSL(sf::Color col) {
-    // Normalize RGB values
-    float R = float(col.r)/255., G = float(col.g)/255., B = float(col.b)/255.;
+// The 'cached' first frames of the tensor come from the cache, their model is resumed from the
+// cached state when there is one. 'state' receives the final model when the cache is enabled.
+void DPEstimator::fit_online(FrameStore & frames, int cached, std::vector<float> & state) {
+    StreamingMLEstimator estimator;
+    estimator.create(WIDTH * HEIGHT, forgetting);
+    estimator.setThreads(scheduler.getThreads());
+    
+    int first = 0;
+    std::vector<float> previous;
+    if (cached > 0 && cache.loadState(state) && estimator.setState(state)) {
+        tensorDensity.transpose(DensityTensor::FRAME_MAJOR);
+        previous.assign(tensorDensity.getData(), tensorDensity.getData() + tensorDensity.getCount());
+        first = cached;
+    }
     
-    // Intermediate variables
-    float V = max(R, G, B);
-    float C = V - min(R, G, B);
+    // Out of core, the frames are written one by one to a tensor of a single band, compact ones are encoded one by one
+    bool compact = storage != CompactTensor::FLOAT32;
+    bool spill = !spill_path.empty() && !compact;
+    if (compact)
+        compactDensity.create(N, WIDTH, HEIGHT, storage, storage_presets);
+    else if (spill)
+        tensorDensity.createFile(getSpillFile("online"), N, WIDTH, HEIGHT, HEIGHT);
+    else
+        tensorDensity.create(N, WIDTH, HEIGHT, DensityTensor::FRAME_MAJOR, 0.);
     
-    // Compute H, SL, H
-    float L = V - C/2;
+    std::size_t plane_size = std::size_t(WIDTH) * HEIGHT;
+    for (int k = 0; k < first; k++) {
+        if (compact)
+            compactDensity.encode(k, 0, HEIGHT, previous.data() + k * plane_size);
+        else if (spill)
+            tensorDensity.writeFrame(k, previous.data() + k * plane_size);
+        else
+            std::copy(previous.begin() + k * plane_size, previous.begin() + (k+1) * plane_size, tensorDensity.getFrame(k));
+    }
+    if (compact)
+        tensorDensity.create(0, 0, 0, DensityTensor::PIXEL_MAJOR, 0.);
     
-    float H = 0.;
-    if (C == 0)
-        H = 0;
-    else if (V == R)
-        H = 60. * (G - B) / C;
-    else if (V == G)
-        H = 60. * ( 2. + (B - R) / C );
-    else if (V == B)
-        H = 60. * ( 4. + (R - G) / C );
+    // Each frame is scored against the model of the frames seen so far, itself included
+    Vector3Array frame;
+    std::vector<float> density(spill || compact ? plane_size : 0);
+    Progress progress("online", (long long) (N - first) * WIDTH * HEIGHT);
+    for (int k = first; k < N; k++) {
+        const sf::Uint8* pixels = frames.getFrame(k);
+        Profiler::Scope scope(Profiler::FIT, (long long) WIDTH * HEIGHT);
+        {
+            Profiler::Scope color_scope(Profiler::COLOR, (long long) WIDTH * HEIGHT);
+            colorspace.convert(pixels, WIDTH * HEIGHT, frame);
+        }
+        estimator.update(frame, spill || compact ? density.data() : tensorDensity.getFrame(k));
+        if (compact)
+            compactDensity.encode(k, 0, HEIGHT, density.data());
+        else if (spill)
+            tensorDensity.writeFrame(k, density.data());
+        progress.advance((long long) WIDTH * HEIGHT);
+    }
+    progress.finish();
     
-    float SL = 0.;
-    if (L == 0. || L == 1.)
-        SL = 0.;
+    if (cache.isEnabled())
+        estimator.getState(state);
+}
+
+// PIXEL_MAJOR tensor for the timepixel fits, a BAND_MAJOR file out of core, or the compact tensor
+void DPEstimator::createTensor(FrameStore & frames, std::string method) {
+    if (storage != CompactTensor::FLOAT32) {
+        compactDensity.create(N, WIDTH, HEIGHT, storage, storage_presets);
+        tensorDensity.create(0, 0, 0, DensityTensor::PIXEL_MAJOR, 0.);
+    } else if (spill_path.empty())
+        tensorDensity.create(N, WIDTH, HEIGHT, DensityTensor::PIXEL_MAJOR, 0.);
     else
-        SL = (V - L)/min(L, 1. - L);
+        tensorDensity.createFile(getSpillFile(method), N, WIDTH, HEIGHT, getBandRows(frames));
+}
+
+// Rows fitted at once: those the frame store can hand out, and out of core or compact those
+// whose densities fit in the budget (twice, for the transpose)
+int DPEstimator::getBandRows(FrameStore & frames) {
+    int rows = frames.getBandRows();
+    if (isBanded()) {
+        std::size_t budget = storage != CompactTensor::FLOAT32 ? storage_budget : spill_budget;
+        std::size_t row_bytes = 2 * sizeof(float) * std::size_t(WIDTH) * std::size_t(N);
+        rows = std::max(1, std::min(rows, int(budget / row_bytes)));
+    }
     
-    return Vector3(H/360., SL, L);
+    // The blocks of a pyramid fit do not straddle two bands
+    if (pyramid > 1 && rows < HEIGHT)
+        rows = std::max(pyramid, rows / pyramid * pyramid);
+    return rows;
+}
+
+// Out of core or compact, the densities are fitted by bands which do not stay in memory
+bool DPEstimator::isBanded() {
+    return !spill_path.empty() || storage != CompactTensor::FLOAT32;
+}
+
+void DPEstimator::beginBand(int rows) {
+    if (isBanded())
+        bandDensity.create(N, WIDTH, rows, DensityTensor::PIXEL_MAJOR, 0.);
 }
 
-float max(float a, float b) {
-    if (a > b)
-        return a;
+// N densities of the timepixel (i, j), j being in the band starting at row j0
+float* DPEstimator::getDensities(int i, int j, int j0) {
+    if (!isBanded())
+        return tensorDensity.getPixel(i, j);
     else
-        return b;
+        return bandDensity.getPixel(i, j - j0);
 }
 
-float max(float a, float b, float c) {
-    return max(a, max(b, c));
+// The band is encoded frame by frame in parallel, or written frame by frame to the file out of core
+void DPEstimator::endBand(int j0) {
+    if (!isBanded())
+        return;
+    
+    bandDensity.transpose(DensityTensor::FRAME_MAJOR);
+    int rows = (int) (bandDensity.getCount() / N / WIDTH);
+    std::unique_lock<std::shared_mutex> lock(density_mutex);
+    if (storage != CompactTensor::FLOAT32) {
+        scheduler.run(N, 1, 1, [&](const TileScheduler::Tile & tile, int) {
+            compactDensity.encode(tile.x0, j0, rows, bandDensity.getFrame(tile.x0));
+        });
+    } else
+        tensorDensity.writeBand(j0, bandDensity);
+    bandDensity.create(0, 0, 0, DensityTensor::PIXEL_MAJOR, 0.);
+    markFitted(0, j0, WIDTH, j0 + rows);
+}
+
+// Fit the tiles of the band starting at row j0, the ones of highest priority first when there is one.
+// Once written to the tensor, the densities of a tile can be evaluated. 'progress' counts at most
+// the whole refinement budget of the band until the pixels to refine are known.
+void DPEstimator::fitTiles(int j0, int rows, Progress & progress, const std::function<void(const TileScheduler::Tile &, Scratch &)> & fit) {
+    if (pyramid <= 1) {
+        runTiles(j0, rows, fit, true);
+        return;
+    }
+    
+    // The pixel of each block first, then the blocks to refine
+    selection.assign(std::size_t(rows) * WIDTH, 0);
+    for (int j = 0; j < rows; j += pyramid)
+        for (int i = 0; i < WIDTH; i += pyramid)
+            selection[std::size_t(j) * WIDTH + i] = 1;
+    runTiles(j0, rows, fit, false);
+    
+    selectRefinement(j0, rows);
+    long long refined = std::count(selection.begin(), selection.end(), 1);
+    progress.add((long long) N * (refined - getRefineBudget(rows)));
+    runTiles(j0, rows, fit, false);
+    
+    // The other pixels take the densities of their block
+    runTiles(j0, rows, [&](const TileScheduler::Tile & tile, Scratch &) {
+        for (int j = j0 + tile.y0; j < j0 + tile.y1; j++) {
+            for (int i = tile.x0; i < tile.x1; i++) {
+                int bi = i - i % pyramid, bj = j - (j - j0) % pyramid;
+                if ((bi != i || bj != j) && !isSelected(i, j, j0))
+                    std::copy(getDensities(bi, bj, j0), getDensities(bi, bj, j0) + N, getDensities(i, j, j0));
+            }
+        }
+    }, true);
+    selection.clear();
 }
 
-float min(float a, float b) {
-    if (a < b)
-        return a;
+// Run 'fit' over the tiles of the band holding a selected pixel, and mark them fitted when 'mark'
+void DPEstimator::runTiles(int j0, int rows, const std::function<void(const TileScheduler::Tile &, Scratch &)> & fit, bool mark) {
+    auto task = [&](const TileScheduler::Tile & tile, int thread) {
+        if (cancelled || (!mark && getSelected(tile) == 0))
+            return;
+        fit(tile, scratch[thread]);
+        if (mark && !isBanded())
+            markFitted(tile.x0, j0 + tile.y0, tile.x1, j0 + tile.y1);
+    };
+    
+    if (!ordered)
+        scheduler.run(WIDTH, rows, TILE_SIZE, task);
     else
-        return b;
+        scheduler.run(WIDTH, rows, TILE_SIZE, task, [&](const TileScheduler::Tile & tile) { return getPriority(tile, j0); });
+}
+
+// Pixel (i, j) of the band starting at row j0 is fitted by the current pass
+bool DPEstimator::isSelected(int i, int j, int j0) {
+    return selection.empty() || selection[std::size_t(j - j0) * WIDTH + i];
+}
+
+// Pixels of the tile fitted by the current pass, the tile and the selection being relative to the band
+int DPEstimator::getSelected(const TileScheduler::Tile & tile) {
+    if (selection.empty())
+        return (tile.x1 - tile.x0) * (tile.y1 - tile.y0);
+    
+    int count = 0;
+    for (int j = tile.y0; j < tile.y1; j++)
+        for (int i = tile.x0; i < tile.x1; i++)
+            count += selection[std::size_t(j) * WIDTH + i];
+    return count;
+}
+
+// Select the pixels of the blocks of the band to fit at full resolution. A block counts the frames
+// where the density of its fitted pixel is within a factor exp(REFINE_MARGIN) of a threshold, or on
+// the other side of a threshold than the one of a 4-neighbour block. The blocks counting the most
+// frames are refined first, those counting none never.
+void DPEstimator::selectRefinement(int j0, int rows) {
+    int F = pyramid;
+    int blocks_x = (WIDTH + F - 1) / F, blocks_y = (rows + F - 1) / F;
+    
+    std::vector<float> low, high;
+    for (float t : pyramid_thresholds) {
+        low.push_back(t * expf(-REFINE_MARGIN));
+        high.push_back(t * expf(REFINE_MARGIN));
+    }
+    auto getLevel = [&](float d) {
+        int level = 0;
+        for (float t : pyramid_thresholds)
+            level += d <= t;
+        return level;
+    };
+    
+    std::vector<int> score(std::size_t(blocks_x) * blocks_y, 0);
+    scheduler.run(blocks_x, blocks_y, TILE_SIZE, [&](const TileScheduler::Tile & tile, int) {
+        for (int by = tile.y0; by < tile.y1; by++) {
+            for (int bx = tile.x0; bx < tile.x1; bx++) {
+                const float* density = getDensities(bx * F, j0 + by * F, j0);
+                const float* neighbours[4];
+                int n = 0;
+                if (bx > 0)
+                    neighbours[n++] = getDensities((bx - 1) * F, j0 + by * F, j0);
+                if (bx < blocks_x - 1)
+                    neighbours[n++] = getDensities((bx + 1) * F, j0 + by * F, j0);
+                if (by > 0)
+                    neighbours[n++] = getDensities(bx * F, j0 + (by - 1) * F, j0);
+                if (by < blocks_y - 1)
+                    neighbours[n++] = getDensities(bx * F, j0 + (by + 1) * F, j0);
+                
+                int frames = 0;
+                for (int k = 0; k < N; k++) {
+                    bool uncertain = false;
+                    for (std::size_t t = 0; t < low.size(); t++)
+                        uncertain = uncertain || (density[k] >= low[t] && density[k] <= high[t]);
+                    int level = getLevel(density[k]);
+                    for (int b = 0; b < n && !uncertain; b++)
+                        uncertain = getLevel(neighbours[b][k]) != level;
+                    frames += uncertain;
+                }
+                score[std::size_t(by) * blocks_x + bx] = frames;
+            }
+        }
+    });
+    
+    std::vector<int> order;
+    for (int b = 0; b < (int) score.size(); b++)
+        if (score[b] > 0)
+            order.push_back(b);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return score[a] > score[b]; });
+    
+    // Within the budget of the pixels left to fit
+    long long budget = getRefineBudget(rows);
+    std::fill(selection.begin(), selection.end(), 0);
+    for (int b : order) {
+        int x0 = (b % blocks_x) * F, y0 = (b / blocks_x) * F;
+        int x1 = std::min(x0 + F, WIDTH), y1 = std::min(y0 + F, rows);
+        long long size = (long long) (x1 - x0) * (y1 - y0) - 1;
+        if (size > budget)
+            break;
+        budget -= size;
+        
+        for (int j = y0; j < y1; j++)
+            for (int i = x0; i < x1; i++)
+                selection[std::size_t(j) * WIDTH + i] = i != x0 || j != y0;
+    }
+}
+
+// Most pixels of a band of 'rows' rows the refinement can fit, besides the pixel of each block
+long long DPEstimator::getRefineBudget(int rows) {
+    if (pyramid <= 1)
+        return 0;
+    long long blocks = (long long) ((WIDTH + pyramid - 1) / pyramid) * ((rows + pyramid - 1) / pyramid);
+    return (long long) (refine_budget * ((long long) WIDTH * rows - blocks));
+}
+
+// Timepixels the fit of every band goes through at most, the pixel of each block and
+// the refinement budget under the pyramid
+long long DPEstimator::getFitPixels(int band_rows) {
+    long long pixels = 0;
+    for (int j0 = 0; j0 < HEIGHT; j0 += band_rows) {
+        int rows = std::min(band_rows, HEIGHT - j0);
+        if (pyramid <= 1)
+            pixels += (long long) WIDTH * rows;
+        else
+            pixels += (long long) ((WIDTH + pyramid - 1) / pyramid) * ((rows + pyramid - 1) / pyramid) + getRefineBudget(rows);
+    }
+    return (long long) N * pixels;
+}
+
+// Mean variance of the pixels of the tile, or closeness to the center
+float DPEstimator::getPriority(const TileScheduler::Tile & tile, int j0) {
+    if (priority != nullptr && priority->getCount() == N) {
+        double variance = 0.;
+        for (int j = j0 + tile.y0; j < j0 + tile.y1; j++)
+            for (int i = tile.x0; i < tile.x1; i++)
+                variance += priority->getVariance(i, j);
+        return (float) (variance / ((tile.x1 - tile.x0) * (tile.y1 - tile.y0)));
+    }
+    
+    float dx = 0.5f * (tile.x0 + tile.x1 - WIDTH), dy = 0.5f * (j0 + tile.y0 + j0 + tile.y1 - HEIGHT);
+    return -(dx * dx + dy * dy);
+}
+
+// Count the pixels of [x0, x1) x [y0, y1) as fitted in the cells they fall into
+void DPEstimator::markFitted(int x0, int y0, int x1, int y1) {
+    for (int cy = y0 / TILE_SIZE; cy * TILE_SIZE < y1; cy++) {
+        for (int cx = x0 / TILE_SIZE; cx * TILE_SIZE < x1; cx++) {
+            int w = std::min(x1, (cx + 1) * TILE_SIZE) - std::max(x0, cx * TILE_SIZE);
+            int h = std::min(y1, (cy + 1) * TILE_SIZE) - std::max(y0, cy * TILE_SIZE);
+            cell_pixels[std::size_t(cy) * CELLS_X + cx].fetch_add(w * h, std::memory_order_release);
+        }
+    }
+    fitted_pixels += (x1 - x0) * (y1 - y0);
+}
+
+// Densities of the frame k fitted so far, infinite, thus background, for the pixels still to fit.
+// Within the fit, the tiles are in the PIXEL_MAJOR tensor as soon as they are marked, while the
+// bands of a banded fit are encoded, or written to the spill file, and marked as a whole under the lock.
+const float* DPEstimator::getPartialFrame(int k, std::vector<float> & frame, float & s, float & s2) {
+    frame.assign(std::size_t(WIDTH) * HEIGHT, INFINITY);
+    if (fitted_pixels == 0)
+        return frame.data();
+    
+    bool banded = isBanded();
+    if (banded && storage != CompactTensor::FLOAT32) {
+        s = compactDensity.snap(s);
+        s2 = compactDensity.snap(s2);
+        compactDensity.decode(k, frame.data());
+    } else if (banded)
+        tensorDensity.readFrame(k, fitted_pixels / WIDTH, frame.data());
+    
+    for (std::size_t c = 0; c < cell_pixels.size(); c++) {
+        int x0 = int(c % CELLS_X) * TILE_SIZE, y0 = int(c / CELLS_X) * TILE_SIZE;
+        int x1 = std::min(x0 + TILE_SIZE, WIDTH), y1 = std::min(y0 + TILE_SIZE, HEIGHT);
+        bool fitted = cell_pixels[c].load(std::memory_order_acquire) == (x1 - x0) * (y1 - y0);
+        
+        for (int j = y0; j < y1; j++) {
+            float* row = &frame[std::size_t(j) * WIDTH];
+            if (!fitted)
+                std::fill(row + x0, row + x1, INFINITY);
+            else if (!banded)
+                for (int i = x0; i < x1; i++)
+                    row[i] = tensorDensity.getPixel(i, j)[k];
+        }
+    }
+    return frame.data();
+}
+
+std::string DPEstimator::getSpillFile(std::string method) {
+    std::string name = "density-" + method + "-" + std::to_string(getpid()) + "-" + std::to_string(std::uintptr_t(this)) + ".tmp";
+    return (fs::path(spill_path) / name).string();
 }
 
-float min(float a, float b, float c) {
-    return min(a, min(b, c));
+// Method and parameters the densities depend on
+std::string DPEstimator::getSignature(std::string method) {
+    if (pyramid <= 1 || !method.compare("online"))
+        return getModelSignature(method);
+    
+    std::string signature = getModelSignature(method) + " pyramid " + std::to_string(pyramid) + " refine " + std::to_string(refine_budget);
+    for (float t : pyramid_thresholds)
+        signature += " " + std::to_string(logf(t));
+    return signature;
+}
+
+std::string DPEstimator::getModelSignature(std::string method) {
+    std::string color = " color " + ColorSpace::getName(colorspace.getSpace());
+    if (!method.compare("online"))
+        return method + color + " forgetting " + std::to_string(forgetting);
+    if (!method.compare("gmm"))
+        return method + color + " components " + std::to_string(gmm_components) + " " + GMMEstimator::getName(gmm_covariance);
+    if (getWindow() > 0)
+        color += " window " + std::to_string(getWindow());
+    if (!method.compare("kde"))
+        return method + color + " tolerance " + std::to_string(kde_tolerance);
+    if (!method.compare("mle") && reuseStatistics())
+        return method + color + " statistics";
+    return method + color;
+}
+
+bool DPEstimator::reuseStatistics() {
+    return statistics != nullptr && statistics->getCount() == N && statistics->getSpace() == colorspace.getSpace() && getWindow() == 0;
+}
+
+// Size of the sliding window, 0 when the densities are estimated from the whole sequence. It holds
+// at least 4 frames, so that the covariance of a window can have full rank.
+int DPEstimator::getWindow() {
+    int w = std::max(window, 4);
+    return window > 0 && w < N ? w : 0;
+}
+
+// Color values of a tile of the band 'rows' in every frame, frame by frame, to the scratch values[k * tile pixels + pixel]
+void DPEstimator::convertTile(const std::vector<const sf::Uint8*> & rows, const TileScheduler::Tile & tile, Scratch & scratch) {
+    int tile_width = tile.x1 - tile.x0, tile_pixels = tile_width * (tile.y1 - tile.y0);
+    Profiler::Scope scope(Profiler::COLOR, (long long) N * tile_pixels);
+    Vector3Array & values = scratch.values;
+    values.resize(N * tile_pixels);
+    
+    // A pyramid pass skips the rows without a selected pixel
+    std::vector<std::uint8_t> & skip = scratch.skip;
+    skip.assign(tile.y1 - tile.y0, 0);
+    if (!selection.empty())
+        for (int j = tile.y0; j < tile.y1; j++)
+            skip[j - tile.y0] = std::none_of(&selection[std::size_t(j) * WIDTH + tile.x0], &selection[std::size_t(j) * WIDTH + tile.x1],
+                                             [](std::uint8_t selected) { return selected != 0; });
+    
+    for (int k = 0; k < N; k++) {
+        for (int j = tile.y0; j < tile.y1; j++) {
+            if (skip[j - tile.y0])
+                continue;
+            int offset = k * tile_pixels + (j - tile.y0) * tile_width;
+            colorspace.convert(rows[k] + 4 * (j * WIDTH + tile.x0), tile_width,
+                               values.x.data() + offset, values.y.data() + offset, values.z.data() + offset);
+        }
+    }
 }
@@ -12,34 +12,170 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <shared_mutex>
+#include <functional>
 
 #include <SFML/Graphics.hpp>
 
 #include "LinearAlgebra.hpp"
 #include "MLEstimator.hpp"
 #include "KDEstimator.hpp"
+#include "GMMEstimator.hpp"
+#include "StreamingMLEstimator.hpp"
+#include "FrameStore.hpp"
+#include "DensityTensor.hpp"
+#include "CompactTensor.hpp"
+#include "TileScheduler.hpp"
+#include "MaskExtractor.hpp"
+#include "ThresholdIndex.hpp"
+#include "PottsSegmenter.hpp"
+#include "DensityCache.hpp"
+#include "ColorSpace.hpp"
+#include "PixelStatistics.hpp"
+#include "Profiler.hpp"
+#include "Progress.hpp"
 
 // Density Pixel Estimator
 class DPEstimator {
 public:
+    // Buffers and Potts settings of the masks evaluated by another thread than the one calling
+    // evaluate(int, float, float), each thread having its own
+    struct Evaluation {
+        MaskExtractor extractor;
+        PottsSegmenter potts;
+        std::vector<float> plane;
+        float smoothness = 0., smoothing_budget = 30.;
+    };
+    
     DPEstimator();
+    ~DPEstimator();
     
-    void fit(const std::vector<std::string> &, std::string);
+    void fit(FrameStore &, std::string);
+    void start(FrameStore &, std::string);
+    void wait();
+    bool isFitting();
+    float getProgress();
+    void setLayout(DensityTensor::Layout);
+    void setThreads(int);
+    void setKDETolerance(float);
+    void setColorSpace(ColorSpace::Space, bool);
+    void setForgetting(float);
+    void setWindow(int);
+    void setGMM(int, GMMEstimator::Covariance);
+    void setCache(std::string);
+    void setStatistics(PixelStatistics*);
+    void setSpill(std::string, std::size_t);
+    void setStorage(CompactTensor::Format, const std::vector<float> &, std::size_t);
+    void setSmoothness(float, float);
+    void setPriority(bool, PixelStatistics*);
+    void setPyramid(int, float, const std::vector<float> &);
     
-    sf::Image evaluate(int, float, float);
+    const sf::Uint8* evaluate(int, float, float);
+    const sf::Uint8* evaluate(int, float, float, Evaluation &);
+    const std::vector<MaskExtractor::Component> & getComponents();
     
 private:
-    static Vector3 RGBtoYCbCr(sf::Color);
-    static Vector3 RGBtoHSL(sf::Color);
+    void begin(FrameStore &);
+    void fitTensor(FrameStore &, std::string);
+    // Buffers and estimators of a fit thread, grown to the largest tile and reused from one pixel
+    // and tile to the next, so that the fit does not allocate once every thread has fitted a tile
+    struct Scratch {
+        Vector3Array values;    // Tile of every frame
+        Vector3Array timePixel;
+        Vector3Array selected;  // Samples of the selected pixels of the tile
+        std::vector<int> pixels;
+        std::vector<float> density;
+        std::vector<std::uint8_t> skip;
+        MLEstimator mlestimator;
+        KDEstimator kdestimator;
+        GMMEstimator gmmestimator;
+    };
+    
+    void fitTiles(int, int, Progress &, const std::function<void(const TileScheduler::Tile &, Scratch &)> &);
+    void runTiles(int, int, const std::function<void(const TileScheduler::Tile &, Scratch &)> &, bool);
+    bool isSelected(int, int, int);
+    int getSelected(const TileScheduler::Tile &);
+    void selectRefinement(int, int);
+    long long getRefineBudget(int);
+    long long getFitPixels(int);
+    float getPriority(const TileScheduler::Tile &, int);
+    void markFitted(int, int, int, int);
+    const float* getPartialFrame(int, std::vector<float> &, float &, float &);
     
-    void fit_mle(const std::vector<std::string> &);
-    void fit_kde(const std::vector<std::string> &);
+    void convertTile(const std::vector<const sf::Uint8*> &, const TileScheduler::Tile &, Scratch &);
     
-    void spread(sf::Image&, int, int, int, float);
+    void createTensor(FrameStore &, std::string);
+    int getBandRows(FrameStore &);
+    bool isBanded();
+    void beginBand(int);
+    float* getDensities(int, int, int);
+    void endBand(int);
+    std::string getSpillFile(std::string);
+    
+    void fit_mle(FrameStore &);
+    void fit_kde(FrameStore &);
+    void fit_gmm(FrameStore &);
+    void fit_online(FrameStore &, int, std::vector<float> &);
+    std::string getSignature(std::string);
+    std::string getModelSignature(std::string);
+    bool reuseStatistics();
+    int getWindow();
+
     
     int N, WIDTH, HEIGHT;
     
-    std::vector<std::vector<std::vector<float>>> tensorDensity; // WIDTH x HEIGHT x N
+    DensityTensor tensorDensity; // WIDTH x HEIGHT x N
+    DensityTensor::Layout layout;
+    CompactTensor compactDensity; // Replaces tensorDensity when the storage is not FLOAT32
+    CompactTensor::Format storage;
+    std::vector<float> storage_presets;
+    std::size_t storage_budget;
+    std::vector<float> plane;
+    MaskExtractor extractor;
+    ThresholdIndex index;
+    int index_frame, last_frame; // Frame of the index, frame of the last evaluation
+    bool last_indexed;
+    const float INDEX_MARGIN = expf(3.); // Levels indexed above s2
+    PottsSegmenter potts;
+    float smoothness; // Potts weight of the masks, 0 for the hysteresis masks
+    
+    ColorSpace colorspace;
+    float kde_tolerance;
+    float forgetting;
+    int window; // Frames of the sliding window, 0 for the whole sequence
+    int gmm_components;
+    GMMEstimator::Covariance gmm_covariance;
+    
+    int pyramid; // Side of the blocks fitted at a single pixel first, 1 without pyramid
+    float refine_budget; // Fraction of the other pixels fitted at full resolution at most
+    std::vector<float> pyramid_thresholds;
+    std::vector<std::uint8_t> selection; // Pixels of the band fitted by the current pass, empty for all
+    const float REFINE_MARGIN = 1.; // Log densities around a threshold where a block is refined, a step of the viewer keys
+    
+    DensityCache cache;
+    std::string spill_path;
+    std::size_t spill_budget;
+    DensityTensor bandDensity; // Band being fitted out of core or encoded
+    PixelStatistics* statistics;
+    
+    TileScheduler scheduler;
+    const int TILE_SIZE = 32;
+    std::vector<Scratch> scratch; // One per thread of the scheduler while fitting
+    
+    // Fit in progress, in the background or not: the pixels of each TILE_SIZE cell of the image whose
+    // densities are written, so that the complete cells are evaluated while the others are fitted.
+    // The lock is shared by the evaluations, and taken by the fit to reshape the densities.
+    std::thread fit_thread;
+    std::atomic<bool> fitting, cancelled;
+    std::vector<std::atomic<int>> cell_pixels;
+    std::atomic<int> fitted_pixels;
+    int CELLS_X;
+    bool ordered;
+    PixelStatistics* priority;
+    std::shared_mutex density_mutex;
 };
 
 #endif /* DPEstimator_hpp */
@@ -0,0 +1,154 @@
+//
+//  DensityCache.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "DensityCache.hpp"
+
+namespace fs = std::filesystem;
+
+DensityCache::DensityCache() {
+    WIDTH = 0;
+    HEIGHT = 0;
+    key = 0;
+    loaded.n = 0;
+}
+
+// Directory of the cache files, the cache is disabled when empty
+void DensityCache::setDirectory(std::string dir) {
+    directory = dir;
+}
+
+bool DensityCache::isEnabled() {
+    return !directory.empty();
+}
+
+// Identify the fit: the input path, the dimensions and the method with its parameters name
+// the file, the frames are checked one by one against their identities when it is loaded
+void DensityCache::setKey(std::string input, const std::vector<std::string> & identities, int width, int height, std::string method) {
+    WIDTH = width;
+    HEIGHT = height;
+    
+    std::error_code error;
+    std::string imageset = fs::absolute(input, error).lexically_normal().string();
+    
+    std::uint32_t version = VERSION;
+    key = hash(&version, sizeof(version), 14695981039346656037ull);
+    key = hash(imageset.data(), imageset.size(), key);
+    key = hash(method.data(), method.size(), key);
+    key = hash(&WIDTH, sizeof(WIDTH), key);
+    key = hash(&HEIGHT, sizeof(HEIGHT), key);
+    
+    fingerprints.resize(identities.size());
+    for (std::size_t k = 0; k < identities.size(); k++)
+        fingerprints[k] = hash(identities[k].data(), identities[k].size(), 14695981039346656037ull);
+    
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.dpc", (unsigned long long) key);
+    path = (fs::path(directory) / name).string();
+}
+
+// Map the cached tensor, return the number of leading frames it holds that are still valid
+// (0 when there is no usable file). The tensor is only mapped when this number is not 0.
+int DensityCache::load(DensityTensor & tensor) {
+    loaded.n = 0;
+    
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 0;
+    
+    Header header;
+    if (!file.read((char*) &header, sizeof(Header)) ||
+        std::memcmp(header.magic, "VSDC", 4) != 0 || header.version != VERSION || header.key != key ||
+        header.width != WIDTH || header.height != HEIGHT ||
+        header.n <= 0 || header.n > (int) fingerprints.size()) {
+        return 0;
+    }
+    
+    std::vector<std::uint64_t> cached(header.n);
+    if (!file.read((char*) cached.data(), header.n * sizeof(std::uint64_t)))
+        return 0;
+    
+    // Frames changed before the end of the cached sequence invalidate the whole file
+    if (!std::equal(cached.begin(), cached.end(), fingerprints.begin()))
+        return 0;
+    
+    if (!tensor.map(path, header.data_offset, header.n, WIDTH, HEIGHT, (DensityTensor::Layout) header.layout)) {
+        std::cout << "ERROR: Could not map " << path << "\n";
+        return 0;
+    }
+    
+    loaded = header;
+    std::cout << "INFO: Density cache " << path << " (" << header.n << "/" << fingerprints.size() << " frames)\n";
+    
+    return header.n;
+}
+
+// Estimator state saved with the last loaded tensor
+bool DensityCache::loadState(std::vector<float> & state) {
+    if (loaded.n == 0 || loaded.state_count == 0)
+        return false;
+    
+    std::ifstream file(path, std::ios::binary);
+    std::size_t tensor_bytes = std::size_t(loaded.n) * WIDTH * HEIGHT * sizeof(float);
+    
+    state.resize(loaded.state_count);
+    file.seekg(loaded.data_offset + tensor_bytes);
+    return bool(file.read((char*) state.data(), state.size() * sizeof(float)));
+}
+
+// Write the tensor of every frame of the key, with an optional estimator state
+// The file is written aside then renamed, a mapped previous version stays readable
+bool DensityCache::save(DensityTensor & tensor, const std::vector<float> & state) {
+    std::error_code error;
+    fs::create_directories(directory, error);
+    
+    Header header;
+    std::memcpy(header.magic, "VSDC", 4);
+    header.version = VERSION;
+    header.key = key;
+    header.n = (int) fingerprints.size();
+    header.width = WIDTH;
+    header.height = HEIGHT;
+    header.layout = tensor.getLayout();
+    header.data_offset = ((sizeof(Header) + fingerprints.size() * sizeof(std::uint64_t) + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    header.state_count = state.size();
+    
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    
+    std::vector<char> padding(header.data_offset - sizeof(Header) - fingerprints.size() * sizeof(std::uint64_t), 0);
+    file.write((const char*) &header, sizeof(Header));
+    file.write((const char*) fingerprints.data(), fingerprints.size() * sizeof(std::uint64_t));
+    file.write(padding.data(), padding.size());
+    file.write((const char*) tensor.getData(), tensor.getCount() * sizeof(float));
+    file.write((const char*) state.data(), state.size() * sizeof(float));
+    file.close();
+    
+    if (!file) {
+        std::cout << "ERROR: Could not write the density cache " << tmp_path << "\n";
+        fs::remove(tmp_path, error);
+        return false;
+    }
+    
+    fs::rename(tmp_path, path, error);
+    if (error) {
+        std::cout << "ERROR: Could not write the density cache " << path << "\n";
+        return false;
+    }
+    
+    return true;
+}
+
+// FNV-1a
+std::uint64_t DensityCache::hash(const void* bytes, std::size_t size, std::uint64_t h) {
+    const unsigned char* b = (const unsigned char*) bytes;
+    for (std::size_t i = 0; i < size; i++) {
+        h ^= b[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
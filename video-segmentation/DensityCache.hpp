@@ -0,0 +1,63 @@
+//
+//  DensityCache.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef DensityCache_hpp
+#define DensityCache_hpp
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+
+#include "DensityTensor.hpp"
+
+// Fitted density tensors persisted on disk, one file per imageset and method
+// The file holds a header, the fingerprint of every frame (a hash of its
+// identity given by the frame source), the tensor at a
+// page aligned offset so that it can be mapped in place, then the state of a streaming estimator.
+// The cached tensor is valid for the frames whose fingerprints still match: all of them when
+// nothing changed, the leading ones when frames were appended.
+class DensityCache {
+public:
+    DensityCache();
+    
+    void setDirectory(std::string);
+    bool isEnabled();
+    
+    void setKey(std::string, const std::vector<std::string> &, int, int, std::string);
+    int load(DensityTensor &);
+    bool loadState(std::vector<float> &);
+    bool save(DensityTensor &, const std::vector<float> &);
+    
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::int32_t n, width, height, layout;
+        std::uint64_t data_offset;   // Bytes before the tensor
+        std::uint64_t state_count;   // Floats of estimator state after the tensor
+    };
+    
+    static std::uint64_t hash(const void*, std::size_t, std::uint64_t);
+    
+    static const std::uint32_t VERSION = 2;
+    static const std::size_t PAGE_SIZE = 4096;
+    
+    std::string directory, path;
+    int WIDTH, HEIGHT;
+    std::uint64_t key;
+    std::vector<std::uint64_t> fingerprints;
+    Header loaded; // Header of the last loaded file
+};
+
+#endif /* DensityCache_hpp */
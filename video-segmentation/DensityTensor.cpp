@@ -0,0 +1,259 @@
+//
+//  DensityTensor.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "DensityTensor.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+DensityTensor::DensityTensor() {
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    layout = PIXEL_MAJOR;
+    band_rows = 0;
+    values = nullptr;
+    mapping = nullptr;
+    mapping_bytes = 0;
+    file = -1;
+}
+
+DensityTensor::~DensityTensor() {
+    release();
+    if (file >= 0) {
+        close(file);
+        unlink(file_path.c_str());
+    }
+}
+
+void DensityTensor::create(int n, int width, int height, Layout l, float value) {
+    release();
+    
+    N = n;
+    WIDTH = width;
+    HEIGHT = height;
+    layout = l;
+    
+    data.assign(std::size_t(N) * std::size_t(WIDTH) * std::size_t(HEIGHT), value);
+    values = data.data();
+}
+
+// Use the tensor stored at 'offset' (page aligned) in the file 'path' without reading it
+// The pages are loaded on first access and private: writes never reach the file
+bool DensityTensor::map(std::string path, std::size_t offset, int n, int width, int height, Layout l) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    
+    std::size_t count = std::size_t(n) * std::size_t(width) * std::size_t(height);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || std::size_t(info.st_size) < offset + count * sizeof(float)) {
+        close(fd);
+        return false;
+    }
+    
+    std::size_t bytes = offset + count * sizeof(float);
+    void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+    
+    release();
+    data.clear();
+    data.shrink_to_fit();
+    
+    N = n;
+    WIDTH = width;
+    HEIGHT = height;
+    layout = l;
+    
+    mapping = address;
+    mapping_bytes = bytes;
+    values = (float*) ((char*) address + offset);
+    
+    return true;
+}
+
+// Start a BAND_MAJOR tensor of bands of 'rows' rows in the file 'path', filled by writeBand
+// (or writeFrame when there is a single band), then mapped by closeFile
+bool DensityTensor::createFile(std::string path, int n, int width, int height, int rows) {
+    release();
+    data.clear();
+    data.shrink_to_fit();
+    
+    N = n;
+    WIDTH = width;
+    HEIGHT = height;
+    layout = BAND_MAJOR;
+    band_rows = rows;
+    
+    file_path = path;
+    file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0 || ftruncate(file, getCount() * sizeof(float)) != 0) {
+        std::cout << "ERROR: Could not create " << path << "\n";
+        return false;
+    }
+    
+    return true;
+}
+
+// Write the band starting at row j0, given as a FRAME_MAJOR tensor of its rows
+bool DensityTensor::writeBand(int j0, DensityTensor & band) {
+    return write(std::size_t(j0) * WIDTH * N, band.getData(), band.getCount());
+}
+
+// Write the plane of the frame k, the tensor being a single band
+bool DensityTensor::writeFrame(int k, const float* plane) {
+    return write(std::size_t(k) * WIDTH * HEIGHT, plane, std::size_t(WIDTH) * HEIGHT);
+}
+
+// Rows [0, rows) of the plane of the frame k from the bands written to the file so far
+bool DensityTensor::readFrame(int k, int rows, float* plane) {
+    for (int j0 = 0; j0 < rows; j0 += band_rows) {
+        std::size_t band_size = std::size_t(std::min(band_rows, HEIGHT - j0)) * WIDTH;
+        char* bytes = (char*) (plane + std::size_t(j0) * WIDTH);
+        std::size_t left = band_size * sizeof(float);
+        off_t position = (std::size_t(j0) * WIDTH * N + std::size_t(k) * band_size) * sizeof(float);
+        
+        while (left > 0) {
+            ssize_t read = pread(file, bytes, left, position);
+            if (read <= 0) {
+                std::cout << "ERROR: Could not read " << file_path << "\n";
+                return false;
+            }
+            bytes += read;
+            left -= read;
+            position += read;
+        }
+    }
+    
+    return true;
+}
+
+bool DensityTensor::write(std::size_t offset, const float* src, std::size_t count) {
+    const char* bytes = (const char*) src;
+    std::size_t left = count * sizeof(float);
+    off_t position = offset * sizeof(float);
+    
+    while (left > 0) {
+        ssize_t written = pwrite(file, bytes, left, position);
+        if (written <= 0) {
+            std::cout << "ERROR: Could not write " << file_path << "\n";
+            return false;
+        }
+        bytes += written;
+        left -= written;
+        position += written;
+    }
+    
+    return true;
+}
+
+// Map the written file, which is removed from the directory as soon as it is mapped
+bool DensityTensor::closeFile() {
+    close(file);
+    file = -1;
+    
+    int rows = band_rows;
+    bool mapped = map(file_path, 0, N, WIDTH, HEIGHT, BAND_MAJOR);
+    band_rows = rows;
+    unlink(file_path.c_str());
+    
+    if (!mapped)
+        std::cout << "ERROR: Could not map " << file_path << "\n";
+    return mapped;
+}
+
+void DensityTensor::release() {
+    if (mapping != nullptr)
+        munmap(mapping, mapping_bytes);
+    
+    mapping = nullptr;
+    mapping_bytes = 0;
+    values = data.data();
+}
+
+// A BAND_MAJOR tensor stays on disk
+void DensityTensor::transpose(Layout l) {
+    if (l == layout || layout == BAND_MAJOR)
+        return;
+    
+    // Out-of-place transpose of the (pixels x N) matrix, by square blocks to stay in cache
+    const int BLOCK = 32;
+    int rows = WIDTH * HEIGHT, cols = N;
+    if (layout == FRAME_MAJOR)
+        std::swap(rows, cols);
+    
+    std::vector<float> transposed(getCount());
+    for (int r0 = 0; r0 < rows; r0 += BLOCK)
+        for (int c0 = 0; c0 < cols; c0 += BLOCK)
+            for (int r = r0; r < std::min(r0 + BLOCK, rows); r++)
+                for (int c = c0; c < std::min(c0 + BLOCK, cols); c++)
+                    transposed[std::size_t(c) * rows + r] = values[std::size_t(r) * cols + c];
+    
+    data.swap(transposed);
+    release();
+    layout = l;
+}
+
+DensityTensor::Layout DensityTensor::getLayout() {
+    return layout;
+}
+
+// Values in the current layout
+const float* DensityTensor::getData() {
+    return values;
+}
+
+std::size_t DensityTensor::getCount() {
+    return std::size_t(N) * std::size_t(WIDTH) * std::size_t(HEIGHT);
+}
+
+// N contiguous densities of the pixel (i, j), PIXEL_MAJOR only
+float* DensityTensor::getPixel(int i, int j) {
+    return &values[(std::size_t(j) * WIDTH + i) * N];
+}
+
+// HEIGHT x WIDTH plane of the frame k, FRAME_MAJOR only
+float* DensityTensor::getFrame(int k) {
+    return &values[std::size_t(k) * WIDTH * HEIGHT];
+}
+
+// HEIGHT x WIDTH plane of the frame k, gathered into 'plane' when the tensor is PIXEL_MAJOR
+const float* DensityTensor::getFrame(int k, std::vector<float> & plane) {
+    if (layout == FRAME_MAJOR)
+        return &values[std::size_t(k) * WIDTH * HEIGHT];
+    
+    if (layout == BAND_MAJOR) {
+        plane.resize(std::size_t(WIDTH) * HEIGHT);
+        for (int j0 = 0; j0 < HEIGHT; j0 += band_rows) {
+            std::size_t band_size = std::size_t(std::min(band_rows, HEIGHT - j0)) * WIDTH;
+            const float* src = &values[std::size_t(j0) * WIDTH * N + std::size_t(k) * band_size];
+            std::copy(src, src + band_size, plane.begin() + std::size_t(j0) * WIDTH);
+        }
+        return plane.data();
+    }
+    
+    plane.resize(std::size_t(WIDTH) * HEIGHT);
+    for (std::size_t p = 0; p < plane.size(); p++)
+        plane[p] = values[p * N + k];
+    
+    return plane.data();
+}
+
+float& DensityTensor::at(int k, int i, int j) {
+    if (layout == FRAME_MAJOR)
+        return values[(std::size_t(k) * HEIGHT + j) * WIDTH + i];
+    else if (layout == BAND_MAJOR) {
+        int j0 = j - j % band_rows, rows = std::min(band_rows, HEIGHT - j0);
+        return values[std::size_t(j0) * WIDTH * N + (std::size_t(k) * rows + (j - j0)) * WIDTH + i];
+    } else
+        return values[(std::size_t(j) * WIDTH + i) * N + k];
+}
@@ -0,0 +1,70 @@
+//
+//  DensityTensor.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef DensityTensor_hpp
+#define DensityTensor_hpp
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+
+// Flat WIDTH x HEIGHT x N density tensor
+// PIXEL_MAJOR stores the N densities of a timepixel contiguously (fitting),
+// FRAME_MAJOR stores each frame as a HEIGHT x WIDTH plane (evaluation).
+// BAND_MAJOR cuts the image in bands of rows, each band being FRAME_MAJOR: it is written band
+// by band to a file (out-of-core fitting), then read through a mapping.
+// The values are either owned or mapped from a file (copy-on-write, the file is never modified).
+class DensityTensor {
+public:
+    enum Layout { PIXEL_MAJOR, FRAME_MAJOR, BAND_MAJOR };
+    
+    DensityTensor();
+    ~DensityTensor();
+    DensityTensor(const DensityTensor &) = delete;
+    DensityTensor & operator=(const DensityTensor &) = delete;
+    
+    void create(int, int, int, Layout, float);
+    bool map(std::string, std::size_t, int, int, int, Layout);
+    
+    bool createFile(std::string, int, int, int, int);
+    bool writeBand(int, DensityTensor &);
+    bool writeFrame(int, const float*);
+    bool readFrame(int, int, float*);
+    bool closeFile();
+    void transpose(Layout);
+    
+    Layout getLayout();
+    const float* getData();
+    std::size_t getCount();
+    
+    float* getPixel(int, int);
+    float* getFrame(int);
+    const float* getFrame(int, std::vector<float> &);
+    float& at(int, int, int);
+    
+private:
+    int N, WIDTH, HEIGHT;
+    Layout layout;
+    int band_rows;     // BAND_MAJOR
+    
+    void release();
+    bool write(std::size_t, const float*, std::size_t);
+    
+    std::vector<float> data;
+    float* values; // data or the mapped file
+    
+    void* mapping;
+    std::size_t mapping_bytes;
+    
+    std::string file_path; // File being written
+    int file;
+};
+
+#endif /* DensityTensor_hpp */
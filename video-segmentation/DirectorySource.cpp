@@ -0,0 +1,106 @@
+//
+//  DirectorySource.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "DirectorySource.hpp"
+
+namespace fs = std::filesystem;
+
+const std::vector<std::string> DirectorySource::SUPPORTED_IMAGE_FORMATS = {".png", ".jpg", ".jpeg"};
+
+DirectorySource::DirectorySource() {
+    WIDTH = 0;
+    HEIGHT = 0;
+}
+
+// Sorted image files of a directory
+std::vector<std::string> DirectorySource::list(std::string inputPath) {
+    std::vector<std::string> filenames = {};
+    
+    for (const auto& entry : fs::directory_iterator(inputPath)) {
+        std::string file_extension = entry.path().extension();
+        std::string file_name = entry.path().string();
+        if (isSupported(file_extension))
+            filenames.push_back(file_name);
+    }
+    
+    std::sort(filenames.begin(), filenames.end());
+    
+    return filenames;
+}
+
+bool DirectorySource::isSupported(std::string ext) {
+    for (const auto& exti : SUPPORTED_IMAGE_FORMATS)
+        if (ext.compare(exti) == 0)
+            return true;
+    
+    return false;
+}
+
+bool DirectorySource::open(std::string path) {
+    files = list(path);
+    if (files.empty()) {
+        std::cout << "ERROR: empty imageset\n";
+        return false;
+    }
+    
+    // Get the frame dimensions
+    sf::Image image_info;
+    if (!image_info.loadFromFile(files[0])) {
+        std::cout << "ERROR: cannot decode " << files[0] << "\n";
+        return false;
+    }
+    WIDTH = image_info.getSize().x;
+    HEIGHT = image_info.getSize().y;
+    
+    return true;
+}
+
+int DirectorySource::size() {
+    return (int) files.size();
+}
+
+sf::Vector2u DirectorySource::getSize() {
+    return sf::Vector2u(WIDTH, HEIGHT);
+}
+
+std::string DirectorySource::getName(int k) {
+    return fs::path(files[k]).stem().string();
+}
+
+// Path, size and modification time of the file
+std::string DirectorySource::getIdentity(int k) {
+    std::error_code error;
+    std::uintmax_t size = fs::file_size(files[k], error);
+    long long mtime = fs::last_write_time(files[k], error).time_since_epoch().count();
+    
+    return files[k] + "|" + std::to_string(size) + "|" + std::to_string(mtime);
+}
+
+bool DirectorySource::isSeekable() {
+    return true;
+}
+
+bool DirectorySource::read(int k, sf::Uint8* dst) {
+    std::size_t frame_bytes = 4 * std::size_t(WIDTH) * std::size_t(HEIGHT);
+    
+    sf::Image image;
+    if (!image.loadFromFile(files[k])) {
+        std::cout << "ERROR: cannot decode " << files[k] << "\n";
+        std::memset(dst, 0, frame_bytes);
+        return false;
+    }
+    
+    if ((int) image.getSize().x != WIDTH || (int) image.getSize().y != HEIGHT) {
+        std::cout << "ERROR: " << files[k] << " does not match the imageset dimensions\n";
+        std::memset(dst, 0, frame_bytes);
+        return false;
+    }
+    
+    std::memcpy(dst, image.getPixelsPtr(), frame_bytes);
+    return true;
+}
@@ -0,0 +1,48 @@
+//
+//  DirectorySource.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef DirectorySource_hpp
+#define DirectorySource_hpp
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSource.hpp"
+
+// Directory of images, one frame per file in file name order
+class DirectorySource : public FrameSource {
+public:
+    DirectorySource();
+    
+    static std::vector<std::string> list(std::string);
+    
+    bool open(std::string);
+    
+    int size();
+    sf::Vector2u getSize();
+    std::string getName(int);
+    std::string getIdentity(int);
+    bool isSeekable();
+    
+    bool read(int, sf::Uint8*);
+    
+private:
+    static bool isSupported(std::string);
+    
+    static const std::vector<std::string> SUPPORTED_IMAGE_FORMATS;
+    
+    std::vector<std::string> files;
+    int WIDTH, HEIGHT;
+};
+
+#endif /* DirectorySource_hpp */
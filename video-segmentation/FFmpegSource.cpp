@@ -0,0 +1,157 @@
+//
+//  FFmpegSource.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "FFmpegSource.hpp"
+
+#ifdef VIDEO_SEGMENTATION_FFMPEG
+
+FFmpegSource::FFmpegSource() {
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    next = 0;
+    format = nullptr;
+    codec = nullptr;
+    scaler = nullptr;
+    packet = nullptr;
+    frame = nullptr;
+    stream = -1;
+    draining = false;
+}
+
+FFmpegSource::~FFmpegSource() {
+    sws_freeContext(scaler);
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&codec);
+    avformat_close_input(&format);
+}
+
+bool FFmpegSource::open(std::string p) {
+    path = p;
+    
+    if (avformat_open_input(&format, path.c_str(), nullptr, nullptr) < 0 || avformat_find_stream_info(format, nullptr) < 0) {
+        std::cout << "ERROR: cannot open " << path << "\n";
+        return false;
+    }
+    
+    const AVCodec* decoder = nullptr;
+    stream = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if (stream < 0 || decoder == nullptr) {
+        std::cout << "ERROR: no video stream in " << path << "\n";
+        return false;
+    }
+    
+    codec = avcodec_alloc_context3(decoder);
+    if (avcodec_parameters_to_context(codec, format->streams[stream]->codecpar) < 0 || avcodec_open2(codec, decoder, nullptr) < 0) {
+        std::cout << "ERROR: cannot open the decoder of " << path << "\n";
+        return false;
+    }
+    WIDTH = codec->width;
+    HEIGHT = codec->height;
+    
+    scaler = sws_getContext(WIDTH, HEIGHT, codec->pix_fmt, WIDTH, HEIGHT, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    
+    // Count the frames by demuxing the stream, the container count is often missing or wrong
+    while (av_read_frame(format, packet) >= 0) {
+        if (packet->stream_index == stream)
+            N++;
+        av_packet_unref(packet);
+    }
+    
+    // The frames are only known once decoded: any change of the file changes the identity of every
+    // frame, so that the cache of a rewritten video, appended to or not, is never used
+    std::error_code error;
+    identity = path + "|" + std::to_string(std::filesystem::file_size(path, error)) + "|" +
+               std::to_string(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    
+    return N > 0 && rewind();
+}
+
+int FFmpegSource::size() {
+    return N;
+}
+
+sf::Vector2u FFmpegSource::getSize() {
+    return sf::Vector2u(WIDTH, HEIGHT);
+}
+
+std::string FFmpegSource::getName(int k) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%06d", k);
+    return std::filesystem::path(path).stem().string() + "-" + number;
+}
+
+// Frames of a compressed stream cannot be told apart cheaply: any change of the file changes them all
+std::string FFmpegSource::getIdentity(int k) {
+    return identity + "#" + std::to_string(k);
+}
+
+bool FFmpegSource::isSeekable() {
+    return false;
+}
+
+// Decode up to the frame k, rewinding when it was already passed
+bool FFmpegSource::read(int k, sf::Uint8* dst) {
+    std::lock_guard<std::mutex> lock(decoder_mutex);
+    
+    if (k < next && !rewind())
+        return false;
+    
+    while (next < k)
+        if (!decodeNext(nullptr))
+            return false;
+    
+    return decodeNext(dst);
+}
+
+bool FFmpegSource::rewind() {
+    if (av_seek_frame(format, stream, 0, AVSEEK_FLAG_BACKWARD) < 0) {
+        std::cout << "ERROR: cannot seek in " << path << "\n";
+        return false;
+    }
+    avcodec_flush_buffers(codec);
+    next = 0;
+    draining = false;
+    return true;
+}
+
+// Decode the next frame, converted to RGBA into dst when given
+bool FFmpegSource::decodeNext(sf::Uint8* dst) {
+    while (true) {
+        int status = avcodec_receive_frame(codec, frame);
+        if (status == 0) {
+            if (dst != nullptr) {
+                uint8_t* planes[1] = {dst};
+                int strides[1] = {4 * WIDTH};
+                sws_scale(scaler, frame->data, frame->linesize, 0, HEIGHT, planes, strides);
+            }
+            av_frame_unref(frame);
+            next++;
+            return true;
+        }
+        if (status != AVERROR(EAGAIN) || draining) {
+            std::cout << "ERROR: cannot decode frame " << next << " of " << path << "\n";
+            return false;
+        }
+        
+        // Feed the decoder with the next packet of the stream, or flush it at the end
+        if (av_read_frame(format, packet) < 0) {
+            avcodec_send_packet(codec, nullptr);
+            draining = true;
+            continue;
+        }
+        if (packet->stream_index == stream)
+            avcodec_send_packet(codec, packet);
+        av_packet_unref(packet);
+    }
+}
+
+#endif /* VIDEO_SEGMENTATION_FFMPEG */
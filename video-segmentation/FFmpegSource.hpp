@@ -0,0 +1,68 @@
+//
+//  FFmpegSource.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef FFmpegSource_hpp
+#define FFmpegSource_hpp
+
+#ifdef VIDEO_SEGMENTATION_FFMPEG
+
+#include <string>
+#include <mutex>
+#include <cstdio>
+#include <filesystem>
+
+#include <SFML/Graphics.hpp>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+#include "FrameSource.hpp"
+
+// Any video FFmpeg can demux and decode (link with avformat, avcodec, swscale and avutil)
+// Frames are decoded in order: reading an earlier frame rewinds to the start of the stream.
+class FFmpegSource : public FrameSource {
+public:
+    FFmpegSource();
+    ~FFmpegSource();
+    
+    bool open(std::string);
+    
+    int size();
+    sf::Vector2u getSize();
+    std::string getName(int);
+    std::string getIdentity(int);
+    bool isSeekable();
+    
+    bool read(int, sf::Uint8*);
+    
+private:
+    bool rewind();
+    bool decodeNext(sf::Uint8*);
+    
+    std::string path;
+    std::string identity;
+    int N, WIDTH, HEIGHT;
+    int next; // Frame the decoder returns next
+    
+    AVFormatContext* format;
+    AVCodecContext* codec;
+    SwsContext* scaler;
+    AVPacket* packet;
+    AVFrame* frame;
+    int stream;
+    bool draining;
+    
+    std::mutex decoder_mutex;
+};
+
+#endif /* VIDEO_SEGMENTATION_FFMPEG */
+
+#endif /* FFmpegSource_hpp */
@@ -0,0 +1,107 @@
+//
+//  FramePrefetcher.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "FramePrefetcher.hpp"
+
+FramePrefetcher::FramePrefetcher() {
+    source = nullptr;
+    N = 0;
+    frame_bytes = 0;
+    slots = 0;
+    head = 0;
+    count = 0;
+    generation = 0;
+    stopping = false;
+}
+
+FramePrefetcher::~FramePrefetcher() {
+    stop();
+}
+
+// Start decoding from the first frame, up to 'n_slots' frames ahead
+void FramePrefetcher::start(FrameSource* src, int n_slots) {
+    stop();
+    
+    source = src;
+    N = source->size();
+    frame_bytes = 4 * std::size_t(source->getSize().x) * std::size_t(source->getSize().y);
+    slots = std::max(1, n_slots);
+    ring.resize(frame_bytes * slots);
+    slot_ok.assign(slots, false);
+    head = 0;
+    count = 0;
+    stopping = false;
+    
+    thread = std::thread(&FramePrefetcher::work, this);
+}
+
+// Copy the frame k to dst, waiting for the decode thread if it is not ready yet
+bool FramePrefetcher::read(int k, sf::Uint8* dst) {
+    std::unique_lock<std::mutex> lock(ring_mutex);
+    
+    if (k != head) {
+        Profiler::count(Profiler::PREFETCH_RESTART);
+        head = k;
+        count = 0;
+        generation++;
+        not_full.notify_one();
+    }
+    
+    not_empty.wait(lock, [&]() { return count > 0 || head >= N; });
+    if (head >= N)
+        return false;
+    
+    int slot = k % slots;
+    std::memcpy(dst, &ring[frame_bytes * slot], frame_bytes);
+    bool ok = slot_ok[slot];
+    
+    head++;
+    count--;
+    not_full.notify_one();
+    
+    return ok;
+}
+
+void FramePrefetcher::stop() {
+    if (!thread.joinable())
+        return;
+    
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        stopping = true;
+    }
+    not_full.notify_all();
+    thread.join();
+}
+
+void FramePrefetcher::work() {
+    std::unique_lock<std::mutex> lock(ring_mutex);
+    
+    while (true) {
+        not_full.wait(lock, [&]() { return stopping || (count < slots && head + count < N); });
+        if (stopping)
+            return;
+        
+        // The slot of the next frame is not read by the consumer, which waits for older frames
+        int k = head + count, slot = k % slots, gen = generation;
+        lock.unlock();
+        bool ok;
+        {
+            Profiler::Scope scope(Profiler::DECODE, frame_bytes / 4);
+            ok = source->read(k, &ring[frame_bytes * slot]);
+        }
+        lock.lock();
+        
+        // Dropped if the stream restarted meanwhile
+        if (gen == generation) {
+            slot_ok[slot] = ok;
+            count++;
+            not_empty.notify_one();
+        }
+    }
+}
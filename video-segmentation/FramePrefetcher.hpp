@@ -0,0 +1,54 @@
+//
+//  FramePrefetcher.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef FramePrefetcher_hpp
+#define FramePrefetcher_hpp
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSource.hpp"
+#include "Profiler.hpp"
+
+// Decode thread reading a source ahead of a consumer that reads its frames in order
+// Decoded frames wait in a bounded ring buffer; reading another frame than the next one
+// restarts the stream from that frame.
+class FramePrefetcher {
+public:
+    FramePrefetcher();
+    ~FramePrefetcher();
+    
+    void start(FrameSource*, int);
+    bool read(int, sf::Uint8*);
+    void stop();
+    
+private:
+    void work();
+    
+    FrameSource* source;
+    int N;
+    std::size_t frame_bytes;
+    
+    std::vector<sf::Uint8> ring; // Frame f in slot f % slots
+    std::vector<bool> slot_ok;
+    int slots;
+    int head, count;  // Frames [head, head + count) are decoded
+    int generation;   // Incremented when the stream restarts
+    bool stopping;
+    
+    std::mutex ring_mutex;
+    std::condition_variable not_empty, not_full;
+    std::thread thread;
+};
+
+#endif /* FramePrefetcher_hpp */
@@ -0,0 +1,46 @@
+//
+//  FrameSource.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "FrameSource.hpp"
+
+#include "DirectorySource.hpp"
+#include "Y4MSource.hpp"
+#include "SyntheticSource.hpp"
+#ifdef VIDEO_SEGMENTATION_FFMPEG
+#include "FFmpegSource.hpp"
+#endif
+
+FrameSource::~FrameSource() {
+    
+}
+
+// Backend of 'path': a directory, a .y4m file, a generated sequence, or any other video through FFmpeg
+std::unique_ptr<FrameSource> FrameSource::create(std::string path) {
+    std::unique_ptr<FrameSource> source;
+    std::filesystem::path p(path);
+    
+    if (path.compare(0, 10, "synthetic:") == 0)
+        source.reset(new SyntheticSource());
+    else if (std::filesystem::is_directory(p))
+        source.reset(new DirectorySource());
+    else if (p.extension() == ".y4m")
+        source.reset(new Y4MSource());
+#ifdef VIDEO_SEGMENTATION_FFMPEG
+    else
+        source.reset(new FFmpegSource());
+#endif
+    
+    if (!source) {
+        std::cout << "ERROR: unsupported input " << path << " (built without FFmpeg)\n";
+        return nullptr;
+    }
+    if (!source->open(path))
+        return nullptr;
+    
+    return source;
+}
@@ -0,0 +1,41 @@
+//
+//  FrameSource.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef FrameSource_hpp
+#define FrameSource_hpp
+
+#include <string>
+#include <memory>
+#include <iostream>
+#include <filesystem>
+
+#include <SFML/Graphics.hpp>
+
+// Frames of a sequence, decoded to RGBA
+// Backends: a directory of images, a Y4M video, a generated test sequence, and any container
+// FFmpeg can read when the program is built with VIDEO_SEGMENTATION_FFMPEG. Seekable sources
+// decode any frame at the same cost and from several threads at once, the others are read in
+// order by a single thread.
+class FrameSource {
+public:
+    virtual ~FrameSource();
+    
+    static std::unique_ptr<FrameSource> create(std::string);
+    
+    virtual bool open(std::string) = 0;
+    
+    virtual int size() = 0;
+    virtual sf::Vector2u getSize() = 0;
+    virtual std::string getName(int) = 0;     // Short name of a frame, for the output files
+    virtual std::string getIdentity(int) = 0; // Changes when the frame may have changed
+    virtual bool isSeekable() = 0;
+    
+    virtual bool read(int, sf::Uint8*) = 0;
+};
+
+#endif /* FrameSource_hpp */
@@ -0,0 +1,202 @@
+//
+//  FrameStore.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "FrameStore.hpp"
+
+FrameStore::FrameStore() {
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    frame_bytes = 0;
+    memory_budget = 0;
+    resident = true;
+    capacity = 0;
+    tick = 0;
+}
+
+bool FrameStore::open(std::string input_path, std::size_t budget, int n_threads) {
+    path = input_path;
+    memory_budget = budget;
+    
+    source = FrameSource::create(path);
+    if (!source)
+        return false;
+    
+    N = source->size();
+    WIDTH = source->getSize().x;
+    HEIGHT = source->getSize().y;
+    frame_bytes = 4 * std::size_t(WIDTH) * std::size_t(HEIGHT);
+    
+    resident = frame_bytes * std::size_t(N) <= memory_budget;
+    
+    if (resident) {
+        std::cout << "INFO: Decode " << N << " frames (" << (frame_bytes * N) / (1024*1024) << " MB)\n";
+        buffer.resize(frame_bytes * std::size_t(N));
+        
+        // Sources read in order are decoded by the prefetch thread while the frames are copied
+        if (!source->isSeekable()) {
+            bool success = true;
+            prefetcher.start(source.get(), PREFETCH_SLOTS);
+            for (int k = 0; k < N; k++)
+                success = prefetcher.read(k, &buffer[frame_bytes * std::size_t(k)]) && success;
+            prefetcher.stop();
+            return success;
+        }
+        
+        // Decode the frames in parallel, each thread picking the next undecoded frame
+        Progress progress("decode", (long long) N * WIDTH * HEIGHT);
+        std::atomic<int> next(0);
+        std::atomic<bool> success(true);
+        auto worker = [&]() {
+            for (int k = next++; k < N; k = next++) {
+                Profiler::Scope scope(Profiler::DECODE, (long long) WIDTH * HEIGHT);
+                if (!source->read(k, &buffer[frame_bytes * std::size_t(k)]))
+                    success = false;
+                progress.advance((long long) WIDTH * HEIGHT);
+            }
+        };
+        
+        if (n_threads <= 0)
+            n_threads = (int) std::thread::hardware_concurrency();
+        n_threads = std::max(1, std::min(N, n_threads));
+        std::vector<std::thread> threads;
+        for (int t = 1; t < n_threads; t++)
+            threads.push_back(std::thread(worker));
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+        progress.finish();
+        
+        return success;
+    }
+    
+    // Half of the budget goes to the LRU and prefetch slots, the other half to the row bands handed to the estimators
+    capacity = std::max(1, int(memory_budget / 2 / frame_bytes) - PREFETCH_SLOTS);
+    std::cout << "INFO: Imageset does not fit in " << memory_budget / (1024*1024) << " MB, caching " << capacity << " frames\n";
+    
+    buffer.resize(frame_bytes * std::size_t(capacity));
+    slot_frame = std::vector<int>(capacity, -1);
+    slot_tick = std::vector<long>(capacity, 0);
+    frame_slot = std::vector<int>(N, -1);
+    tick = 0;
+    
+    prefetcher.start(source.get(), PREFETCH_SLOTS);
+    
+    return true;
+}
+
+int FrameStore::size() {
+    return N;
+}
+
+sf::Vector2u FrameStore::getSize() {
+    return sf::Vector2u(WIDTH, HEIGHT);
+}
+
+std::string FrameStore::getPath() {
+    return path;
+}
+
+std::string FrameStore::getName(int k) {
+    return source->getName(k);
+}
+
+std::string FrameStore::getIdentity(int k) {
+    return source->getIdentity(k);
+}
+
+bool FrameStore::isResident() {
+    return resident;
+}
+
+// The returned pointer stays valid as long as the store is resident,
+// or until 'capacity' other frames have been requested in the LRU fallback
+const sf::Uint8* FrameStore::getFrame(int k) {
+    if (resident)
+        return &buffer[frame_bytes * std::size_t(k)];
+    
+    std::lock_guard<std::mutex> lock(lru_mutex);
+    return getSlot(k);
+}
+
+// Bytes [offset, offset + bytes) of the frame k, copied before another thread can evict it
+void FrameStore::copyFrame(int k, std::size_t offset, std::size_t bytes, sf::Uint8* dst) {
+    if (resident) {
+        std::memcpy(dst, &buffer[frame_bytes * std::size_t(k) + offset], bytes);
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(lru_mutex);
+    std::memcpy(dst, getSlot(k) + offset, bytes);
+}
+
+// Slot of the frame k in the LRU fallback, decoded on a miss, the lock being held
+const sf::Uint8* FrameStore::getSlot(int k) {
+    tick++;
+    
+    int slot = frame_slot[k];
+    if (slot < 0) {
+        // Evict the least recently used slot
+        slot = 0;
+        for (int s = 1; s < capacity; s++)
+            if (slot_tick[s] < slot_tick[slot])
+                slot = s;
+        
+        if (slot_frame[slot] >= 0)
+            frame_slot[slot_frame[slot]] = -1;
+        
+        decode(k, &buffer[frame_bytes * std::size_t(slot)]);
+        slot_frame[slot] = k;
+        frame_slot[k] = slot;
+    }
+    slot_tick[slot] = tick;
+    
+    return &buffer[frame_bytes * std::size_t(slot)];
+}
+
+// Pointers to the row 'row' of every frame, followed by 'rows'-1 contiguous rows.
+// Resident frames are returned in place, otherwise the band is copied into 'band'.
+std::vector<const sf::Uint8*> FrameStore::getRows(int row, int rows, std::vector<sf::Uint8> & band) {
+    std::size_t row_bytes = 4 * std::size_t(WIDTH);
+    std::vector<const sf::Uint8*> rows_ptr(N, nullptr);
+    
+    if (resident) {
+        for (int k = 0; k < N; k++)
+            rows_ptr[k] = &buffer[frame_bytes * std::size_t(k) + row_bytes * std::size_t(row)];
+        return rows_ptr;
+    }
+    
+    band.resize(row_bytes * std::size_t(rows) * std::size_t(N));
+    for (int k = 0; k < N; k++) {
+        sf::Uint8* dst = &band[row_bytes * std::size_t(rows) * std::size_t(k)];
+        copyFrame(k, row_bytes * std::size_t(row), row_bytes * std::size_t(rows), dst);
+        rows_ptr[k] = dst;
+    }
+    
+    return rows_ptr;
+}
+
+// Number of rows of the whole sequence that fit in the band half of the memory budget
+int FrameStore::getBandRows() {
+    if (resident)
+        return HEIGHT;
+    
+    std::size_t row_bytes = 4 * std::size_t(WIDTH) * std::size_t(N);
+    return std::max(1, std::min(HEIGHT, int(memory_budget / 2 / row_bytes)));
+}
+
+// Misses are served by the prefetcher, so that a sequential scan finds its next frames decoded
+bool FrameStore::decode(int k, sf::Uint8* dst) {
+    Profiler::count(Profiler::LRU_MISS);
+    if (!prefetcher.read(k, dst)) {
+        std::cout << "ERROR: cannot decode frame " << k << " of " << path << "\n";
+        std::memset(dst, 0, frame_bytes);
+        return false;
+    }
+    return true;
+}
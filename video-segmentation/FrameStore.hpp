@@ -0,0 +1,75 @@
+//
+//  FrameStore.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef FrameStore_hpp
+#define FrameStore_hpp
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSource.hpp"
+#include "FramePrefetcher.hpp"
+#include "Profiler.hpp"
+#include "Progress.hpp"
+
+// Decoded sequence shared by the viewer and the estimators
+// Every frame is decoded once into a contiguous RGBA buffer (N x HEIGHT x WIDTH x 4).
+// When the sequence does not fit in the memory budget, frames are decoded on demand
+// into a fixed number of slots recycled in least-recently-used order, a decode thread
+// reading the next frames ahead of the misses.
+class FrameStore {
+public:
+    FrameStore();
+    
+    bool open(std::string, std::size_t, int);
+    
+    int size();
+    sf::Vector2u getSize();
+    std::string getPath();
+    std::string getName(int);
+    std::string getIdentity(int);
+    bool isResident();
+    
+    const sf::Uint8* getFrame(int);
+    void copyFrame(int, std::size_t, std::size_t, sf::Uint8*);
+    std::vector<const sf::Uint8*> getRows(int, int, std::vector<sf::Uint8> &);
+    int getBandRows();
+    
+private:
+    const sf::Uint8* getSlot(int);
+    bool decode(int, sf::Uint8*);
+    
+    static const int PREFETCH_SLOTS = 4;
+    
+    std::string path;
+    std::unique_ptr<FrameSource> source;
+    FramePrefetcher prefetcher;
+    int N, WIDTH, HEIGHT;
+    std::size_t frame_bytes, memory_budget;
+    bool resident;
+    
+    std::vector<sf::Uint8> buffer; // N frames when resident, 'capacity' slots otherwise
+    
+    // LRU fallback
+    int capacity;
+    long tick;
+    std::vector<int> slot_frame, frame_slot;
+    std::vector<long> slot_tick;
+    std::mutex lru_mutex;
+};
+
+#endif /* FrameStore_hpp */
@@ -0,0 +1,320 @@
+//
+//  GMMEstimator.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "GMMEstimator.hpp"
+
+GMMEstimator::GMMEstimator() {
+    K = 3;
+    N = 0;
+    STRIDE = 0;
+    offset = 0;
+    P = 0;
+    covariance = DIAGONAL;
+}
+
+void GMMEstimator::setComponents(int components) {
+    K = std::max(1, components);
+}
+
+void GMMEstimator::setCovariance(Covariance c) {
+    covariance = c;
+}
+
+bool GMMEstimator::parse(std::string name, Covariance & c) {
+    if (name == "diagonal" || name == "diag")
+        c = DIAGONAL;
+    else if (name == "full")
+        c = FULL;
+    else
+        return false;
+    return true;
+}
+
+std::string GMMEstimator::getName(Covariance c) {
+    return c == FULL ? "full" : "diagonal";
+}
+
+// Densities of the samples of 'pixels' pixels, given frame by frame: values[k * pixels + p], written
+// to out[k * pixels + p]. The pixels are fitted by blocks whose parameters stay in the L1 cache.
+void GMMEstimator::fit_evaluate(const Vector3Array & values, int pixels, float* out) {
+    STRIDE = pixels;
+    N = values.size() / pixels;
+    
+    for (offset = 0; offset < pixels; offset += BLOCK) {
+        P = std::min(BLOCK, pixels - offset);
+        
+        std::size_t size = std::size_t(K) * P;
+        for (std::vector<float>* v : {&weight, &mx, &my, &mz, &cxx, &cxy, &cxz, &cyy, &cyz, &czz,
+                                      &ixx, &ixy, &ixz, &iyy, &iyz, &izz, &lognorm, &resp})
+            v->assign(size, 0.);
+        total.assign(P, 0.);
+        
+        initialize(values);
+        
+        for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+            for (std::vector<float>* v : {&r, &sx, &sy, &sz, &sxx, &sxy, &sxz, &syy, &syz, &szz})
+                v->assign(size, 0.);
+            
+            for (int k = 0; k < N; k++) {
+                expectation(values, k, false);
+                accumulate(values, k);
+            }
+            maximize();
+        }
+        
+        // Mixture density of each sample
+        for (int k = 0; k < N; k++) {
+            expectation(values, k, true);
+            float* y = out + std::size_t(k) * STRIDE + offset;
+            std::fill(y, y + P, 0.f);
+            for (int c = 0; c < K; c++)
+                for (int p = 0; p < P; p++)
+                    y[p] += resp[c * P + p];
+        }
+    }
+}
+
+// Mean and covariance of every sample for each component, the means then taken farthest first
+void GMMEstimator::initialize(const Vector3Array & values) {
+    const float* x = values.x.data() + offset;
+    const float* y = values.y.data() + offset;
+    const float* z = values.z.data() + offset;
+    
+    // Moments relative to the first sample, in the arrays of the last component
+    std::size_t last = std::size_t(K - 1) * P;
+    s1x.assign(P, 0.);
+    s1y.assign(P, 0.);
+    s1z.assign(P, 0.);
+    for (int k = 0; k < N; k++) {
+        std::size_t q = std::size_t(k) * STRIDE;
+        for (int p = 0; p < P; p++) {
+            float ux = x[q + p] - x[p], uy = y[q + p] - y[p], uz = z[q + p] - z[p];
+            s1x[p] += ux;
+            s1y[p] += uy;
+            s1z[p] += uz;
+            cxx[last + p] += ux * ux;
+            cxy[last + p] += ux * uy;
+            cxz[last + p] += ux * uz;
+            cyy[last + p] += uy * uy;
+            cyz[last + p] += uy * uz;
+            czz[last + p] += uz * uz;
+        }
+    }
+
+    bool full = covariance == FULL;
+    for (int p = 0; p < P; p++) {
+        float dx = s1x[p] / N, dy = s1y[p] / N, dz = s1z[p] / N;
+        std::size_t i = last + p;
+        cxx[i] = cxx[i] / N - dx * dx + VARIANCE_FLOOR;
+        cyy[i] = cyy[i] / N - dy * dy + VARIANCE_FLOOR;
+        czz[i] = czz[i] / N - dz * dz + VARIANCE_FLOOR;
+        cxy[i] = full ? cxy[i] / N - dx * dy : 0.f;
+        cxz[i] = full ? cxz[i] / N - dx * dz : 0.f;
+        cyz[i] = full ? cyz[i] / N - dy * dz : 0.f;
+
+        for (int c = 0; c < K; c++) {
+            std::size_t j = std::size_t(c) * P + p;
+            weight[j] = 1.f / K;
+            mx[j] = x[p] + dx;
+            my[j] = y[p] + dy;
+            mz[j] = z[p] + dz;
+            cxx[j] = cxx[i]; cxy[j] = cxy[i]; cxz[j] = cxz[i];
+            cyy[j] = cyy[i]; cyz[j] = cyz[i]; czz[j] = czz[i];
+        }
+    }
+
+    // Each next mean is the sample farthest from the previous means, in units of the variance of the pixel
+    best.resize(P);
+    for (int c = 1; c < K; c++) {
+        std::fill(best.begin(), best.end(), 0.f);
+        std::size_t j = std::size_t(c) * P;
+        for (int k = 0; k < N; k++) {
+            std::size_t q = std::size_t(k) * STRIDE;
+            for (int p = 0; p < P; p++) {
+                float distance = INFINITY;
+                for (int b = 0; b < c; b++) {
+                    std::size_t i = std::size_t(b) * P + p;
+                    float ux = x[q + p] - mx[i], uy = y[q + p] - my[i], uz = z[q + p] - mz[i];
+                    distance = std::min(distance, ux * ux / cxx[last + p] + uy * uy / cyy[last + p] + uz * uz / czz[last + p]);
+                }
+                if (distance > best[p]) {
+                    best[p] = distance;
+                    mx[j + p] = x[q + p];
+                    my[j + p] = y[q + p];
+                    mz[j + p] = z[q + p];
+                }
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < std::size_t(K) * P; i++)
+        invert((int) i);
+}
+
+// Responsibilities of the components for the samples of frame k, up to the factor 'total' of each
+// pixel, or with 'density' the terms w_c exp(-0.5 * u_c^T cov_c^-1 u_c) of the mixture density
+void GMMEstimator::expectation(const Vector3Array & values, int k, bool density) {
+    const float* x = values.x.data() + std::size_t(k) * STRIDE + offset;
+    const float* y = values.y.data() + std::size_t(k) * STRIDE + offset;
+    const float* z = values.z.data() + std::size_t(k) * STRIDE + offset;
+    bool full = covariance == FULL;
+
+    for (int c = 0; c < K; c++) {
+        std::size_t o = std::size_t(c) * P;
+        const float *m_x = mx.data() + o, *m_y = my.data() + o, *m_z = mz.data() + o;
+        const float *i_xx = ixx.data() + o, *i_yy = iyy.data() + o, *i_zz = izz.data() + o;
+        const float *i_xy = ixy.data() + o, *i_xz = ixz.data() + o, *i_yz = iyz.data() + o;
+        const float* norm = density ? nullptr : lognorm.data() + o;
+        float* out = resp.data() + o;
+
+        if (full) {
+            for (int p = 0; p < P; p++) {
+                float ux = x[p] - m_x[p], uy = y[p] - m_y[p], uz = z[p] - m_z[p];
+                float q = i_xx[p] * ux * ux + i_yy[p] * uy * uy + i_zz[p] * uz * uz +
+                          2.f * (i_xy[p] * ux * uy + i_xz[p] * ux * uz + i_yz[p] * uy * uz);
+                out[p] = -0.5f * q;
+            }
+        } else {
+            for (int p = 0; p < P; p++) {
+                float ux = x[p] - m_x[p], uy = y[p] - m_y[p], uz = z[p] - m_z[p];
+                out[p] = -0.5f * (i_xx[p] * ux * ux + i_yy[p] * uy * uy + i_zz[p] * uz * uz);
+            }
+        }
+
+        if (!density)
+            for (int p = 0; p < P; p++)
+                out[p] += norm[p];
+    }
+
+    if (density) {
+        GaussianKernel::exp(resp.data(), K * P);
+        for (std::size_t i = 0; i < std::size_t(K) * P; i++)
+            resp[i] *= weight[i];
+        return;
+    }
+
+    // Shifted by the largest term of each pixel, which is then exp(0) = 1, the normalization by
+    // the sum of the terms is left to the accumulation
+    std::copy(resp.begin(), resp.begin() + P, total.begin());
+    for (int c = 1; c < K; c++)
+        for (int p = 0; p < P; p++)
+            total[p] = std::max(total[p], resp[c * P + p]);
+    for (int c = 0; c < K; c++)
+        for (int p = 0; p < P; p++)
+            resp[c * P + p] -= total[p];
+    
+    GaussianKernel::exp(resp.data(), K * P);
+    
+    std::copy(resp.begin(), resp.begin() + P, total.begin());
+    for (int c = 1; c < K; c++)
+        for (int p = 0; p < P; p++)
+            total[p] += resp[c * P + p];
+    for (int p = 0; p < P; p++)
+        total[p] = 1.f / total[p];
+}
+
+// Moments of the samples of frame k weighted by their responsibilities
+void GMMEstimator::accumulate(const Vector3Array & values, int k) {
+    const float* x = values.x.data() + std::size_t(k) * STRIDE + offset;
+    const float* y = values.y.data() + std::size_t(k) * STRIDE + offset;
+    const float* z = values.z.data() + std::size_t(k) * STRIDE + offset;
+    const float* inverse_total = total.data();
+    bool full = covariance == FULL;
+    
+    for (int c = 0; c < K; c++) {
+        std::size_t o = std::size_t(c) * P;
+        const float *m_x = mx.data() + o, *m_y = my.data() + o, *m_z = mz.data() + o;
+        const float* term = resp.data() + o;
+        float *s_r = r.data() + o, *s_x = sx.data() + o, *s_y = sy.data() + o, *s_z = sz.data() + o;
+        float *s_xx = sxx.data() + o, *s_yy = syy.data() + o, *s_zz = szz.data() + o;
+        float *s_xy = sxy.data() + o, *s_xz = sxz.data() + o, *s_yz = syz.data() + o;
+        
+        for (int p = 0; p < P; p++) {
+            float w = term[p] * inverse_total[p];
+            float ux = x[p] - m_x[p], uy = y[p] - m_y[p], uz = z[p] - m_z[p];
+            float wx = w * ux, wy = w * uy, wz = w * uz;
+            s_r[p] += w;
+            s_x[p] += wx;
+            s_y[p] += wy;
+            s_z[p] += wz;
+            s_xx[p] += wx * ux;
+            s_yy[p] += wy * uy;
+            s_zz[p] += wz * uz;
+        }
+        if (full) {
+            for (int p = 0; p < P; p++) {
+                float w = term[p] * inverse_total[p];
+                float ux = x[p] - m_x[p], uy = y[p] - m_y[p], uz = z[p] - m_z[p];
+                s_xy[p] += w * ux * uy;
+                s_xz[p] += w * ux * uz;
+                s_yz[p] += w * uy * uz;
+            }
+        }
+    }
+}
+
+// Weights, means and covariances from the moments, a component without samples keeps its mean and covariance
+void GMMEstimator::maximize() {
+    const float MIN_WEIGHT = 1e-3; // Samples of a component below which it is left as is
+    bool full = covariance == FULL;
+
+    for (std::size_t i = 0; i < std::size_t(K) * P; i++) {
+        float n = r[i];
+        weight[i] = n / N;
+        if (n >= MIN_WEIGHT) {
+            float dx = sx[i] / n, dy = sy[i] / n, dz = sz[i] / n;
+            mx[i] += dx;
+            my[i] += dy;
+            mz[i] += dz;
+            cxx[i] = sxx[i] / n - dx * dx + VARIANCE_FLOOR;
+            cyy[i] = syy[i] / n - dy * dy + VARIANCE_FLOOR;
+            czz[i] = szz[i] / n - dz * dz + VARIANCE_FLOOR;
+            if (full) {
+                cxy[i] = sxy[i] / n - dx * dy;
+                cxz[i] = sxz[i] / n - dx * dz;
+                cyz[i] = syz[i] / n - dy * dz;
+            }
+        }
+        invert((int) i);
+    }
+}
+
+// Inverse covariance and log normalization of the component i
+void GMMEstimator::invert(int i) {
+    float a = cxx[i], b = cxy[i], c = cxz[i], e = cyy[i], f = cyz[i], g = czz[i];
+
+    // A full covariance made indefinite by the rounding of its moments falls back to its diagonal
+    float A = e * g - f * f, B = c * f - b * g, C = b * f - c * e;
+    float det = a * A + b * B + c * C;
+    if (covariance == FULL && !(det > 0.f)) {
+        cxy[i] = cxz[i] = cyz[i] = 0.f;
+        b = c = f = 0.f;
+        A = e * g;
+        B = C = 0.f;
+        det = a * A;
+    }
+    
+    if (covariance == FULL) {
+        ixx[i] = A / det;
+        ixy[i] = B / det;
+        ixz[i] = C / det;
+        iyy[i] = (a * g - c * c) / det;
+        iyz[i] = (b * c - a * f) / det;
+        izz[i] = (a * e - b * b) / det;
+    } else {
+        det = a * e * g;
+        ixx[i] = 1.f / a;
+        iyy[i] = 1.f / e;
+        izz[i] = 1.f / g;
+        ixy[i] = 0.f;
+        ixz[i] = 0.f;
+        iyz[i] = 0.f;
+    }
+
+    lognorm[i] = logf(std::max(weight[i], 1e-30f)) - 0.5f * logf(det);
+}
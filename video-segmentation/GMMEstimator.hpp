@@ -0,0 +1,72 @@
+//
+//  GMMEstimator.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef GMMEstimator_hpp
+#define GMMEstimator_hpp
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "LinearAlgebra.hpp"
+#include "GaussianKernel.hpp"
+
+// Gaussian Mixture Model estimator, K components with diagonal or full covariance per pixel
+// The pixels of a tile are fitted together by EM, by blocks: every parameter is an array over the
+// pixels of the block, component c of pixel p at c * P + p, and each step is a loop over the
+// frames whose inner loops run over the pixels, the exponentials going through the batched kernel.
+// An iteration costs O(N K) a pixel. The means start from the mean of the pixel and the samples farthest from the
+// means already chosen, so that a mode seen in a few frames gets its own component. The arrays are
+// sized for a block and reused, an estimator kept by a thread fits tile after tile without allocating.
+// The density of a sample is sum_c w_c exp(-0.5 * u_c^T cov_c^-1 u_c): a single component has the
+// (proportional) density of the MLE, and a mode seen in a fraction w of the frames is at most w.
+class GMMEstimator {
+public:
+    enum Covariance { DIAGONAL, FULL };
+
+    GMMEstimator();
+
+    void setComponents(int);
+    void setCovariance(Covariance);
+
+    void fit_evaluate(const Vector3Array &, int, float*);
+
+    static bool parse(std::string, Covariance &);
+    static std::string getName(Covariance);
+
+private:
+    void initialize(const Vector3Array &);
+    void expectation(const Vector3Array &, int, bool);
+    void accumulate(const Vector3Array &, int);
+    void maximize();
+    void invert(int);
+
+    int K, N;    // Components, frames
+    int STRIDE;  // Pixels of a frame in the values
+    int offset, P; // First pixel and pixels of the block being fitted
+    Covariance covariance;
+
+    // Parameters, K x P
+    std::vector<float> weight, mx, my, mz;
+    std::vector<float> cxx, cxy, cxz, cyy, cyz, czz; // Covariance, symmetric
+    std::vector<float> ixx, ixy, ixz, iyy, iyz, izz; // Inverse covariance, symmetric
+    std::vector<float> lognorm; // log(w) - log(det cov) / 2
+
+    // Sufficient statistics of an iteration, relative to the means of the previous one, K x P
+    std::vector<float> r, sx, sy, sz, sxx, sxy, sxz, syy, syz, szz;
+    std::vector<float> resp;  // Responsibilities of the frame, K x P
+    std::vector<float> total; // Inverse of the sum of the responsibilities of each pixel, P
+    std::vector<float> s1x, s1y, s1z, best; // Initialization, P
+
+    const int BLOCK = 64;
+    const int ITERATIONS = 10;
+    const float VARIANCE_FLOOR = 1e-5; // Added to the covariance, below the noise of an 8-bit channel
+};
+
+#endif /* GMMEstimator_hpp */
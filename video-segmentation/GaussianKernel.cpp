@@ -0,0 +1,233 @@
+//
+//  GaussianKernel.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "GaussianKernel.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GAUSSIANKERNEL_X86
+#endif
+
+// exp(x) = 2^n * exp(r), n = round(x / ln2), |r| <= ln2/2, exp(r) by a degree 7 polynomial (Cephes)
+namespace {
+    const float EXP_HI = 88.3762626647949f;
+    const float EXP_LO = -87.3365447504f;
+    const float LOG2E = 1.44269504088896341f;
+    const float LN2_HI = 0.693359375f;
+    const float LN2_LO = -2.12194440e-4f;
+    const float P0 = 1.9875691500E-4f;
+    const float P1 = 1.3981999507E-3f;
+    const float P2 = 8.3334519073E-3f;
+    const float P3 = 4.1665795894E-2f;
+    const float P4 = 1.6666665459E-1f;
+    const float P5 = 5.0000001201E-1f;
+    
+    typedef void (*KernelFunction)(const float*, const float*, const float*, int, const float*, const float*, bool, float*);
+    typedef void (*ExpFunction)(float*, int);
+    
+    // Quadratic form of the point k, A is given row by row
+    inline float quadratic(float ux, float uy, float uz, const float* a) {
+        return ux * (a[0] * ux + a[1] * uy + a[2] * uz) +
+               uy * (a[3] * ux + a[4] * uy + a[5] * uz) +
+               uz * (a[6] * ux + a[7] * uy + a[8] * uz);
+    }
+    
+    void kernel_scalar(const float* x, const float* y, const float* z, int n, const float* c, const float* a, bool log, float* out) {
+        for (int k = 0; k < n; k++) {
+            float q = -0.5f * quadratic(x[k] - c[0], y[k] - c[1], z[k] - c[2], a);
+            out[k] = log ? q : GaussianKernel::exp(q);
+        }
+    }
+    
+    void exp_scalar(float* x, int n) {
+        for (int k = 0; k < n; k++)
+            x[k] = GaussianKernel::exp(x[k]);
+    }
+
+#ifdef GAUSSIANKERNEL_X86
+    __attribute__((target("avx2,fma")))
+    inline __m256 exp_avx2(__m256 x) {
+        __m256 underflow = _mm256_cmp_ps(x, _mm256_set1_ps(EXP_LO), _CMP_LT_OQ);
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)), _mm256_set1_ps(EXP_HI));
+        
+        __m256 fn = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(LN2_HI), x);
+        r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(LN2_LO), r);
+        
+        __m256 p = _mm256_set1_ps(P0);
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(P1));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(P2));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(P3));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(P4));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(P5));
+        p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.f)));
+        
+        __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(fn), _mm256_set1_epi32(127)), 23);
+        return _mm256_andnot_ps(underflow, _mm256_mul_ps(p, _mm256_castsi256_ps(e)));
+    }
+    
+    __attribute__((target("avx2,fma")))
+    void kernel_avx2(const float* x, const float* y, const float* z, int n, const float* c, const float* a, bool log, float* out) {
+        __m256 a0 = _mm256_set1_ps(a[0]), a1 = _mm256_set1_ps(a[1]), a2 = _mm256_set1_ps(a[2]);
+        __m256 a3 = _mm256_set1_ps(a[3]), a4 = _mm256_set1_ps(a[4]), a5 = _mm256_set1_ps(a[5]);
+        __m256 a6 = _mm256_set1_ps(a[6]), a7 = _mm256_set1_ps(a[7]), a8 = _mm256_set1_ps(a[8]);
+        __m256 cx = _mm256_set1_ps(c[0]), cy = _mm256_set1_ps(c[1]), cz = _mm256_set1_ps(c[2]);
+        __m256 half = _mm256_set1_ps(-0.5f);
+        
+        int k = 0;
+        for (; k + 8 <= n; k += 8) {
+            __m256 ux = _mm256_sub_ps(_mm256_loadu_ps(x + k), cx);
+            __m256 uy = _mm256_sub_ps(_mm256_loadu_ps(y + k), cy);
+            __m256 uz = _mm256_sub_ps(_mm256_loadu_ps(z + k), cz);
+            
+            __m256 vx = _mm256_fmadd_ps(a2, uz, _mm256_fmadd_ps(a1, uy, _mm256_mul_ps(a0, ux)));
+            __m256 vy = _mm256_fmadd_ps(a5, uz, _mm256_fmadd_ps(a4, uy, _mm256_mul_ps(a3, ux)));
+            __m256 vz = _mm256_fmadd_ps(a8, uz, _mm256_fmadd_ps(a7, uy, _mm256_mul_ps(a6, ux)));
+            __m256 q = _mm256_mul_ps(half, _mm256_fmadd_ps(uz, vz, _mm256_fmadd_ps(uy, vy, _mm256_mul_ps(ux, vx))));
+            
+            _mm256_storeu_ps(out + k, log ? q : exp_avx2(q));
+        }
+        kernel_scalar(x + k, y + k, z + k, n - k, c, a, log, out + k);
+    }
+    
+    __attribute__((target("avx2,fma")))
+    void exp_avx2_batch(float* x, int n) {
+        int k = 0;
+        for (; k + 8 <= n; k += 8)
+            _mm256_storeu_ps(x + k, exp_avx2(_mm256_loadu_ps(x + k)));
+        exp_scalar(x + k, n - k);
+    }
+    
+    __attribute__((target("avx512f")))
+    inline __m512 exp_avx512(__m512 x) {
+        __mmask16 valid = _mm512_cmp_ps_mask(x, _mm512_set1_ps(EXP_LO), _CMP_GE_OQ);
+        x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_LO)), _mm512_set1_ps(EXP_HI));
+        
+        __m512 fn = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(LN2_HI), x);
+        r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(LN2_LO), r);
+        
+        __m512 p = _mm512_set1_ps(P0);
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(P1));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(P2));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(P3));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(P4));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(P5));
+        p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.f)));
+        
+        __m512i e = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(fn), _mm512_set1_epi32(127)), 23);
+        return _mm512_maskz_mov_ps(valid, _mm512_mul_ps(p, _mm512_castsi512_ps(e)));
+    }
+    
+    __attribute__((target("avx512f")))
+    void kernel_avx512(const float* x, const float* y, const float* z, int n, const float* c, const float* a, bool log, float* out) {
+        __m512 a0 = _mm512_set1_ps(a[0]), a1 = _mm512_set1_ps(a[1]), a2 = _mm512_set1_ps(a[2]);
+        __m512 a3 = _mm512_set1_ps(a[3]), a4 = _mm512_set1_ps(a[4]), a5 = _mm512_set1_ps(a[5]);
+        __m512 a6 = _mm512_set1_ps(a[6]), a7 = _mm512_set1_ps(a[7]), a8 = _mm512_set1_ps(a[8]);
+        __m512 cx = _mm512_set1_ps(c[0]), cy = _mm512_set1_ps(c[1]), cz = _mm512_set1_ps(c[2]);
+        __m512 half = _mm512_set1_ps(-0.5f);
+        
+        // The tail is handled by masked loads and stores
+        for (int k = 0; k < n; k += 16) {
+            __mmask16 m = n - k >= 16 ? (__mmask16) 0xFFFF : (__mmask16) ((1u << (n - k)) - 1);
+            
+            __m512 ux = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + k), cx);
+            __m512 uy = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, y + k), cy);
+            __m512 uz = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, z + k), cz);
+            
+            __m512 vx = _mm512_fmadd_ps(a2, uz, _mm512_fmadd_ps(a1, uy, _mm512_mul_ps(a0, ux)));
+            __m512 vy = _mm512_fmadd_ps(a5, uz, _mm512_fmadd_ps(a4, uy, _mm512_mul_ps(a3, ux)));
+            __m512 vz = _mm512_fmadd_ps(a8, uz, _mm512_fmadd_ps(a7, uy, _mm512_mul_ps(a6, ux)));
+            __m512 q = _mm512_mul_ps(half, _mm512_fmadd_ps(uz, vz, _mm512_fmadd_ps(uy, vy, _mm512_mul_ps(ux, vx))));
+            
+            _mm512_mask_storeu_ps(out + k, m, log ? q : exp_avx512(q));
+        }
+    }
+    
+    __attribute__((target("avx512f")))
+    void exp_avx512_batch(float* x, int n) {
+        for (int k = 0; k < n; k += 16) {
+            __mmask16 m = n - k >= 16 ? (__mmask16) 0xFFFF : (__mmask16) ((1u << (n - k)) - 1);
+            _mm512_mask_storeu_ps(x + k, m, exp_avx512(_mm512_maskz_loadu_ps(m, x + k)));
+        }
+    }
+#endif
+    
+    KernelFunction select(std::string & name) {
+#ifdef GAUSSIANKERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            name = "avx512";
+            return kernel_avx512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            name = "avx2";
+            return kernel_avx2;
+        }
+#endif
+        name = "scalar";
+        return kernel_scalar;
+    }
+    
+    ExpFunction selectExp() {
+#ifdef GAUSSIANKERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return exp_avx512_batch;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return exp_avx2_batch;
+#endif
+        return exp_scalar;
+    }
+    
+    std::string path_name;
+    const KernelFunction kernel_function = select(path_name);
+    const ExpFunction exp_function = selectExp();
+}
+
+// out[k] = exp(-0.5 * u^T A u) (or its log), u = (x[k], y[k], z[k]) - center
+void GaussianKernel::evaluate(const float* x, const float* y, const float* z, int n, Vector3 center, const Matrix3 & A, bool log, float* out) {
+    float c[3] = {center.x, center.y, center.z};
+    float a[9] = {A.x.x, A.x.y, A.x.z, A.y.x, A.y.y, A.y.z, A.z.x, A.z.y, A.z.z};
+    
+    kernel_function(x, y, z, n, c, a, log, out);
+}
+
+// x[k] = exp(x[k]) by the vectorized exponential, for the kernels computed elsewhere
+void GaussianKernel::exp(float* x, int n) {
+    exp_function(x, n);
+}
+
+// Scalar version of the vectorized exponential
+float GaussianKernel::exp(float x) {
+    if (x < EXP_LO)
+        return 0.;
+    x = std::min(x, EXP_HI);
+    
+    float fn = nearbyintf(x * LOG2E);
+    float r = x - fn * LN2_HI;
+    r = r - fn * LN2_LO;
+    
+    float p = P0;
+    p = p * r + P1;
+    p = p * r + P2;
+    p = p * r + P3;
+    p = p * r + P4;
+    p = p * r + P5;
+    p = p * (r * r) + (r + 1.f);
+    
+    int e = ((int) fn + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &e, sizeof(float));
+    
+    return p * scale;
+}
+
+std::string GaussianKernel::getPath() {
+    return path_name;
+}
@@ -0,0 +1,31 @@
+//
+//  GaussianKernel.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef GaussianKernel_hpp
+#define GaussianKernel_hpp
+
+#include <string>
+#include <cstring>
+#include <cmath>
+
+#include "LinearAlgebra.hpp"
+
+// Batched Gaussian kernel exp(-0.5 * u^T A u), u = x - center, over structure-of-arrays data
+// Evaluates 16 (AVX-512) or 8 (AVX2) points per instruction, the path is chosen at runtime
+// with a scalar fallback. The exponential is a polynomial approximation with a relative
+// error below 2e-7 (about 2 ulp) over [-87.3, 0], arguments below -87.3 flush to 0.
+class GaussianKernel {
+public:
+    static void evaluate(const float*, const float*, const float*, int, Vector3, const Matrix3 &, bool, float*);
+    
+    static float exp(float);
+    static void exp(float*, int);
+    static std::string getPath();
+};
+
+#endif /* GaussianKernel_hpp */
@@ -9,58 +9,243 @@
 #include "KDEstimator.hpp"
 
 KDEstimator::KDEstimator() {
+    tolerance = 0.;
+    window = 0;
+}
+
+// Maximum error on each kernel term, 0 for the exact estimator
+void KDEstimator::setTolerance(float eps) {
+    tolerance = eps;
+}
 
+// Samples each density is estimated from, 0 for the whole sequence
+void KDEstimator::setWindow(int w) {
+    window = w;
 }
 
-float KDEstimator::kernel(Vector3 u) {
-    return expf(-0.5 * u * (H_inv * u));
+// Density of each sample, written to y[k]
+void KDEstimator::fit_evaluate(const Vector3Array & data, float* y) {
+    fit(data);
+    
+    float max_d;
+    if (window > 0)
+        max_d = evaluate_window(data, y);
+    else if (tolerance > 0.)
+        max_d = evaluate_binned(data, y);
+    else
+        max_d = evaluate_exact(data, y);
+    
+    normalize(y, max_d);
 }
 
-std::vector<float> KDEstimator::fit_evaluate(const std::vector<Vector3> & data) {
+void KDEstimator::fit(const Vector3Array & data) {
     n = (int) data.size();
     
-    // - - - - - FITTING - - - - -
     // Compute mean
     Vector3 mean = Vector3::Zeros();
     for (int k = 0; k < n; k++)
-        mean = mean + data[k];
+        mean = mean + data.get(k);
     mean = 1./float(n) * mean;
     
     // Estimate bandwith matrix
     H = Matrix3::Zeros();
     for (int k = 0; k < n; k++)
-        H = H + outerp(data[k]);
-    H = powf(float(n), -2./7.) / float(n-1) * (H - float(n) * outerp(mean)); // Scott's rule + Unbiased sample covariance
+        H = H + outerp(data.get(k));
+    float samples = window > 0 ? float(window) : float(n);
+    H = powf(samples, -2./7.) / float(n-1) * (H - float(n) * outerp(mean)); // Scott's rule + Unbiased sample covariance
     H_inv = H.inverse();
+}
+
+// Each pair is evaluated once, in the upper triangle, and added to the sums of both samples. The rows
+// are taken by blocks whose kernels stay in the cache: K[b * n + j] for row i0 + b and j > i0 + b,
+// a batch of kernels per row. The sum of sample i receives the kernels of j = 0, 1, ..., n-1 in
+// order, from the rows before i then from its own row, like a sum over the full matrix: the
+// densities do not depend on the block size. The sums of the samples after the block are vectors
+// along j, those of the rows of the block are CHAINS independent chains.
+// Returns the maximum density, the sums of a block being complete once it is done.
+float KDEstimator::evaluate_exact(const Vector3Array & data, float* y) {
+    int rows = std::max(1, std::min(BLOCK_ROWS, BLOCK_FLOATS / n));
+    kernels.resize(std::size_t(rows) * n);
+    float* K = kernels.data();
+    std::fill(y, y + n, 0.f);
+    float max_d = 0.;
+    
+    for (int i0 = 0; i0 < n; i0 += rows) {
+        int i1 = std::min(i0 + rows, n);
+        for (int i = i0; i < i1; i++)
+            GaussianKernel::evaluate(data.x.data() + i+1, data.y.data() + i+1, data.z.data() + i+1, n-i-1, data.get(i), H_inv, false,
+                                     K + std::size_t(i - i0) * n + i+1);
+        
+        // Pairs within the block
+        for (int i = i0; i < i1; i++) {
+            const float* row = K + std::size_t(i - i0) * n;
+            for (int j = i+1; j < i1; j++) {
+                y[i] += row[j];
+                y[j] += row[j];
+            }
+        }
+        
+        // Pairs of the block and the samples after it
+        int b = 0;
+        for (; b + CHAINS <= i1 - i0; b += CHAINS) {
+            float s[CHAINS];
+            for (int c = 0; c < CHAINS; c++)
+                s[c] = y[i0 + b + c];
+            for (int j = i1; j < n; j++)
+                for (int c = 0; c < CHAINS; c++)
+                    s[c] += K[std::size_t(b + c) * n + j];
+            for (int c = 0; c < CHAINS; c++)
+                y[i0 + b + c] = s[c];
+        }
+        for (; b < i1 - i0; b++) {
+            const float* row = K + std::size_t(b) * n;
+            float s = y[i0 + b];
+            for (int j = i1; j < n; j++)
+                s += row[j];
+            y[i0 + b] = s;
+        }
+        for (b = 0; b < i1 - i0; b++) {
+            const float* row = K + std::size_t(b) * n;
+            for (int j = i1; j < n; j++)
+                y[j] += row[j];
+        }
+        
+        for (int i = i0; i < i1; i++)
+            if (y[i] > max_d)
+                max_d = y[i];
+    }
+    
+    return max_d;
+}
+
+// Kernels of each sample and the samples [a, a + window) but itself, a being k - window/2 clamped
+// so that the window stays in the sequence
+float KDEstimator::evaluate_window(const Vector3Array & data, float* y) {
+    kernels.resize(window);
+    float* K = kernels.data();
+    float max_d = 0.;
+    
+    for (int k = 0; k < n; k++) {
+        int a = std::min(std::max(k - window / 2, 0), n - window);
+        GaussianKernel::evaluate(data.x.data() + a, data.y.data() + a, data.z.data() + a, window, data.get(k), H_inv, false, K);
+        y[k] = 0.;
+        for (int j = 0; j < window; j++)
+            if (a + j != k)
+                y[k] += K[j];
+        if (y[k] > max_d)
+            max_d = y[k];
+    }
+    
+    return max_d;
+}
+
+// The data is whitened by H so that the kernel becomes exp(-|wi - wj|^2 / 2), then binned in
+// cubic cells of side 'delta'. All the points of a cell share its center, cells further apart
+// than the cutoff radius are ignored:
+//  - moving both points to their cell centers changes the distance by at most delta*sqrt(3),
+//    and the kernel is exp(-1/2)-Lipschitz, so the binning error is below eps/2
+//  - pairs beyond the cutoff are at least 'radius' apart, so the truncation error is below eps/2
+// Only the occupied cells are visited and 8-bit frames give few distinct colors per timepixel,
+// so the cost is O(n log n) for the binning plus the pairs of nearby occupied cells.
+float KDEstimator::evaluate_binned(const Vector3Array & data, float* y) {
+    // Cholesky factorization H_inv = L L^T, the kernel of u is then exp(-|L^T u|^2 / 2)
+    float a11 = H_inv.x.x, a22 = H_inv.y.y, a33 = H_inv.z.z;
+    float a21 = 0.5 * (H_inv.y.x + H_inv.x.y), a31 = 0.5 * (H_inv.z.x + H_inv.x.z), a32 = 0.5 * (H_inv.z.y + H_inv.y.z);
+    
+    if (a11 == 0. && a22 == 0. && a33 == 0. && a21 == 0. && a31 == 0. && a32 == 0.) {
+        std::fill(y, y + n, float(n-1)); // Singular bandwith (constant timepixel), every kernel is 1
+        return float(n-1);
+    }
+    
+    float l11 = 0., l21 = 0., l31 = 0., l22 = 0., l32 = 0., l33 = 0.;
+    bool definite = a11 > 0.;
+    if (definite) {
+        l11 = sqrtf(a11);
+        l21 = a21 / l11;
+        l31 = a31 / l11;
+        definite = a22 - l21*l21 > 0.;
+    }
+    if (definite) {
+        l22 = sqrtf(a22 - l21*l21);
+        l32 = (a32 - l31*l21) / l22;
+        definite = a33 - l31*l31 - l32*l32 > 0.;
+    }
+    if (!definite)
+        return evaluate_exact(data, y);
+    l33 = sqrtf(a33 - l31*l31 - l32*l32);
     
-    // - - - - - Evaluate - - - - -
-    // Initialize K(xi - xj)
-    std::vector<std::vector<float>> K(n, std::vector<float>(n, 0.));
-    for (int i = 0; i < n; i++) {
-        K[i][i] = 1;
-        for (int j = i+1; j < n; j++) {
-            K[i][j] = kernel(data[i] - data[j]);
-            K[j][i] = K[i][j];
+    // Grid resolution and cutoff from the tolerance
+    double delta = tolerance / (2. * exp(-0.5) * sqrt(3.));
+    double radius = sqrt(-2. * log(std::min(0.5 * tolerance, 0.5)));
+    double cutoff = radius + delta * sqrt(3.);
+    long long cutoff_cells = (long long) ceil(cutoff / delta);
+    
+    // Bin the whitened points
+    points.resize(n);
+    for (int k = 0; k < n; k++) {
+        Vector3 u = data.get(k);
+        double wx = l11 * u.x + l21 * u.y + l31 * u.z;
+        double wy = l22 * u.y + l32 * u.z;
+        double wz = l33 * u.z;
+        points[k] = {(long long) floor(wx / delta), (long long) floor(wy / delta), (long long) floor(wz / delta), k};
+    }
+    std::sort(points.begin(), points.end(), [](const Point & a, const Point & b) {
+        if (a.cx != b.cx) return a.cx < b.cx;
+        if (a.cy != b.cy) return a.cy < b.cy;
+        return a.cz < b.cz;
+    });
+    
+    // Occupied cells, sorted along x
+    cell_x.clear();
+    cell_y.clear();
+    cell_z.clear();
+    cell_count.clear();
+    point_cell.resize(n);
+    for (int p = 0; p < n; p++) {
+        if (p == 0 || points[p].cx != points[p-1].cx || points[p].cy != points[p-1].cy || points[p].cz != points[p-1].cz) {
+            cell_x.push_back(points[p].cx);
+            cell_y.push_back(points[p].cy);
+            cell_z.push_back(points[p].cz);
+            cell_count.push_back(0.);
         }
+        cell_count.back() += 1.;
+        point_cell[points[p].k] = (int) cell_count.size() - 1;
     }
     
-    // Sum the kernels
-    std::vector<float> y(n, 0.);
+    // Sum the kernels between nearby cells, a sweep along x bounds the candidates
+    int m = (int) cell_count.size();
+    cell_density.assign(m, 0.);
+    double cutoff2 = cutoff * cutoff;
     
-    for (int i = 0; i < n; i++)
-        for (int j = 0; j < n; j++)
-            if (i != j)
-                y[i] += K[i][j];
+    for (int a = 0; a < m; a++) {
+        cell_density[a] += cell_count[a] - 1.; // Other points of the same cell, K(0) = 1
+        
+        for (int b = a+1; b < m && cell_x[b] - cell_x[a] <= cutoff_cells; b++) {
+            double dx = double(cell_x[b] - cell_x[a]) * delta;
+            double dy = double(cell_y[b] - cell_y[a]) * delta;
+            double dz = double(cell_z[b] - cell_z[a]) * delta;
+            double d2 = dx*dx + dy*dy + dz*dz;
+            
+            if (d2 <= cutoff2) {
+                float k = expf(-0.5 * d2);
+                cell_density[a] += cell_count[b] * k;
+                cell_density[b] += cell_count[a] * k;
+            }
+        }
+    }
     
-    // Find de maxumum density
     float max_d = 0.;
-    for (int k = 0; k < n; k++)
+    for (int k = 0; k < n; k++) {
+        y[k] = cell_density[point_cell[k]];
         if (y[k] > max_d)
             max_d = y[k];
+    }
     
-    // Normalize the density
+    return max_d;
+}
+
+// Divide by the maximum density
+void KDEstimator::normalize(float* y, float max_d) {
     for (int k = 0; k < n; k++)
         y[k] /= max_d;
-    
-    return y;
 }
@@ -11,20 +11,56 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 #include "LinearAlgebra.hpp"
+#include "GaussianKernel.hpp"
 
+// Kernel Density Estimator (Normal kernel, leave-one-out)
+// With a tolerance eps > 0 the densities are computed on a grid instead of the exact
+// O(n^2) sum: every kernel term K(xi - xj) is within eps of its exact value, so each
+// (unnormalized) density is within (n-1) * eps of the exact one.
+// In a sliding window, each sample is scored against the 'window' samples around it, with the
+// bandwidth of the whole sequence scaled for 'window' samples, in O(window) a sample. The binned
+// estimator then does not apply: the kernel sums of the window are exact.
+// The working buffers are members, grown to the largest timepixel and reused: an estimator kept
+// by a thread fits pixel after pixel without allocating.
 class KDEstimator {
 public:
     KDEstimator();
-        
-    std::vector<float> fit_evaluate(const std::vector<Vector3> &);
+    
+    void setTolerance(float);
+    void setWindow(int);
+    
+    void fit_evaluate(const Vector3Array &, float*);
         
 private:
-    float kernel(Vector3);
+    struct Point {
+        long long cx, cy, cz;
+        int k;
+    };
+    
+    void fit(const Vector3Array &);
+    float evaluate_exact(const Vector3Array &, float*);
+    float evaluate_binned(const Vector3Array &, float*);
+    float evaluate_window(const Vector3Array &, float*);
+    void normalize(float*, float);
     
     Matrix3 H, H_inv;
     int n;
+    float tolerance;
+    int window; // 0 for the whole sequence
+    
+    // Scratch
+    std::vector<float> kernels;                    // Kernels of a block of rows, or of a window
+    std::vector<Point> points;                     // Whitened samples in their cells
+    std::vector<long long> cell_x, cell_y, cell_z; // Occupied cells
+    std::vector<float> cell_count, cell_density;
+    std::vector<int> point_cell;
+    
+    static constexpr int BLOCK_ROWS = 32;       // Rows of the exact estimator evaluated at once, at most
+    static constexpr int BLOCK_FLOATS = 32768;  // Kernels of a block, 128 KB
+    static constexpr int CHAINS = 8;            // Rows of a block summed together
 };
 
 #endif /* KDEstimator_hpp */
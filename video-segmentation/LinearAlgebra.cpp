@@ -104,3 +104,32 @@ Matrix3 operator+(const Matrix3 & A, const Matrix3 & B) {
 Matrix3 operator-(const Matrix3 & A, const Matrix3 & B) {
     return Matrix3(A.x - B.x, A.y - B.y, A.z - B.z);
 }
+
+// - - - - - Vector3Array - - - - -
+Vector3Array::Vector3Array() {
+    
+}
+
+Vector3Array::Vector3Array(int n) {
+    resize(n);
+}
+
+void Vector3Array::resize(int n) {
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+}
+
+int Vector3Array::size() const {
+    return (int) x.size();
+}
+
+void Vector3Array::set(int k, Vector3 u) {
+    x[k] = u.x;
+    y[k] = u.y;
+    z[k] = u.z;
+}
+
+Vector3 Vector3Array::get(int k) const {
+    return Vector3(x[k], y[k], z[k]);
+}
@@ -10,6 +10,7 @@
 #define LinearAlgebra_hpp
 
 #include <iostream>
+#include <vector>
 
 #include <SFML/Graphics.hpp>
 
@@ -75,4 +76,21 @@ Matrix3 operator*(float, const Matrix3 &);
 Matrix3 operator+(const Matrix3 &, const Matrix3 &);
 Matrix3 operator-(const Matrix3 &, const Matrix3 &);
 
+
+// - - - - - Vector3Array - - - - -
+// Structure of arrays, for the batched kernels
+class Vector3Array {
+public:
+    Vector3Array();
+    Vector3Array(int);
+    
+    std::vector<float> x, y, z;
+    
+    void resize(int);
+    int size() const;
+    
+    void set(int, Vector3);
+    Vector3 get(int) const;
+};
+
 #endif /* LinearAlgebra_hpp */
@@ -21,39 +21,72 @@ float MLEstimator::evaluate(Vector3 x, bool log) {
     }
 }
 
-std::vector<float> MLEstimator::evaluate(const std::vector<Vector3> & x, bool log) {
-    int x_size = (int) x.size();
-    std::vector<float> y(x_size, 0.);
-    
-    if (!log) {
-        for (int k = 0; k < x_size; k++) {
-            Vector3 temp = x[k] - mean;
-            y[k] = expf(-0.5 * temp * (cov_inv * temp));
-        }
-    } else {
-        for (int k = 0; k < x_size; k++) {
-            Vector3 temp = x[k] - mean;
-            y[k] = -0.5 * temp * (cov_inv * temp);
-        }
-    }
-    
-    return y;
+// y[k] for each sample x[k]
+void MLEstimator::evaluate(const Vector3Array & x, bool log, float* y) {
+    GaussianKernel::evaluate(x.x.data(), x.y.data(), x.z.data(), x.size(), mean, cov_inv, log, y);
 }
 
-void MLEstimator::fit(const std::vector<Vector3> & data) {
+void MLEstimator::fit(const Vector3Array & data) {
     n = (int) data.size();
     
     // Estimate the mean
     mean = Vector3::Zeros();
     for (int k = 0; k < n; k++)
-        mean = mean + data[k];
+        mean = mean + data.get(k);
     mean = 1./float(n) * mean;
     
     // Estimate the covariance
     cov = Matrix3::Zeros();
     for (int k = 0; k < n; k++)
-        cov = cov + outerp(data[k]);
+        cov = cov + outerp(data.get(k));
     cov = 1./float(n-1) * (cov - float(n) * outerp(mean)); // Unbiased sample covariance
     cov_inv = cov.inverse();
 }
 
+
+// Use a mean and an (unbiased) covariance estimated beforehand
+void MLEstimator::fit(Vector3 m, const Matrix3 & c) {
+    mean = m;
+    cov = c;
+    cov_inv = cov.inverse();
+}
+
+// (Proportionnal) density of each sample under the model of the samples [a, a + window), a being
+// k - window/2 clamped so that the window stays in the sequence, written to y[k]
+void MLEstimator::fit_evaluate(const Vector3Array & data, int window, float* y) {
+    n = (int) data.size();
+    
+    // Sums of the samples and their products in double, relative to the first sample so that
+    // removing a sample does not cancel large values
+    Vector3 origin = data.get(0);
+    double s[3] = {0., 0., 0.}, ss[6] = {0., 0., 0., 0., 0., 0.};
+    auto add = [&](int k, double sign) {
+        Vector3 u = data.get(k) - origin;
+        s[0] += sign * u.x;
+        s[1] += sign * u.y;
+        s[2] += sign * u.z;
+        ss[0] += sign * u.x * u.x;
+        ss[1] += sign * u.x * u.y;
+        ss[2] += sign * u.x * u.z;
+        ss[3] += sign * u.y * u.y;
+        ss[4] += sign * u.y * u.z;
+        ss[5] += sign * u.z * u.z;
+    };
+    
+    int first = 0, last = 0; // Samples [first, last) in the sums
+    for (int k = 0; k < n; k++) {
+        int a = std::min(std::max(k - window / 2, 0), n - window);
+        while (last < a + window)
+            add(last++, +1.);
+        while (first < a)
+            add(first++, -1.);
+        
+        double m[3] = {s[0] / window, s[1] / window, s[2] / window};
+        float c = 1. / (window - 1.); // Unbiased sample covariance
+        float xx = c * (ss[0] - window * m[0] * m[0]), xy = c * (ss[1] - window * m[0] * m[1]), xz = c * (ss[2] - window * m[0] * m[2]);
+        float yy = c * (ss[3] - window * m[1] * m[1]), yz = c * (ss[4] - window * m[1] * m[2]), zz = c * (ss[5] - window * m[2] * m[2]);
+        
+        fit(origin + Vector3(m[0], m[1], m[2]), Matrix3(Vector3(xx, xy, xz), Vector3(xy, yy, yz), Vector3(xz, yz, zz)));
+        y[k] = evaluate(data.get(k), false);
+    }
+}
@@ -11,18 +11,28 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 #include "LinearAlgebra.hpp"
+#include "GaussianKernel.hpp"
 
 // Maximum Likelihood Estimator (Normal distribution)
+// The densities are written to a buffer of the caller, one per sample, so that an estimator fits
+// pixel after pixel without allocating.
+// In a sliding window, each sample is scored against the model of the 'window' samples around
+// it. The window slides one sample at a time, adding and removing the sufficient statistics of
+// the samples that enter and leave it, so the cost does not depend on its size.
 class MLEstimator {
 public:
     MLEstimator();
     
-    void fit(const std::vector<Vector3> &);
+    void fit(const Vector3Array &);
+    void fit(Vector3, const Matrix3 &);
     
     float evaluate(Vector3, bool);
-    std::vector<float> evaluate(const std::vector<Vector3> &, bool);
+    void evaluate(const Vector3Array &, bool, float*);
+    
+    void fit_evaluate(const Vector3Array &, int, float*);
     
 private:
     int n;
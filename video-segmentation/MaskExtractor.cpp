@@ -0,0 +1,205 @@
+//
+//  MaskExtractor.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "MaskExtractor.hpp"
+
+MaskExtractor::MaskExtractor() {
+    WIDTH = 0;
+    HEIGHT = 0;
+}
+
+void MaskExtractor::create(int width, int height) {
+    if (width == WIDTH && height == HEIGHT)
+        return;
+    
+    WIDTH = width;
+    HEIGHT = height;
+    
+    row_first.assign(HEIGHT + 1, 0);
+    pixels.assign(std::size_t(WIDTH) * HEIGHT, 0);
+    filled_start.clear();
+    filled_end.clear();
+    components.clear();
+}
+
+// First pass: the runs of each row, merged with the touching runs
+template <typename Rows, typename Value>
+void MaskExtractor::scan(const Rows & rows, Value s, Value s2) {
+    run_start.clear();
+    run_end.clear();
+    run_row.clear();
+    run_loose.clear();
+    run_seeded.clear();
+    parent.clear();
+    
+    Value s_max = std::max(s, s2);
+    
+    for (int j = 0; j < HEIGHT; j++) {
+        const auto* row = rows(j);
+        row_first[j] = (int) run_start.size();
+        
+        int i = 0;
+        while (i < WIDTH) {
+            // Skip the background (NaN densities included)
+            while (i < WIDTH && !(row[i] <= s_max))
+                i++;
+            if (i == WIDTH)
+                break;
+            
+            // Run of reachable pixels
+            if (row[i] <= s2) {
+                int start = i;
+                bool seeded = false;
+                for (; i < WIDTH && row[i] <= s2; i++)
+                    seeded = seeded || row[i] <= s;
+                addRun(j, start, i, false, seeded);
+                continue;
+            }
+            
+            // Seed above s2
+            addRun(j, i, i+1, true, true);
+            i++;
+        }
+        
+        // Runs of the row touching each other: a loose run next to a regular one
+        int first = row_first[j], last = (int) run_start.size();
+        for (int r = first + 1; r < last; r++)
+            if (run_end[r-1] == run_start[r] && !(run_loose[r-1] && run_loose[r]))
+                merge(r-1, r);
+        
+        // Runs overlapping a run of the previous row
+        if (j > 0) {
+            int a = row_first[j-1], b = first;
+            while (a < first && b < last) {
+                if (run_start[a] < run_end[b] && run_start[b] < run_end[a] && !(run_loose[a] && run_loose[b]))
+                    merge(a, b);
+                
+                if (run_end[a] < run_end[b])
+                    a++;
+                else
+                    b++;
+            }
+        }
+    }
+    row_first[HEIGHT] = (int) run_start.size();
+}
+
+// RGBA mask of the plane, red foreground on transparent background, valid until the next call
+const sf::Uint8* MaskExtractor::extract(const float* density, float s, float s2) {
+    Profiler::Scope scope(Profiler::FLOOD_FILL, (long long) WIDTH * HEIGHT);
+    scan([&](int j) { return density + std::size_t(j) * WIDTH; }, s, s2);
+    return fill();
+}
+
+// Mask of a plane of codes that compare as their densities, 'rows(j)' returning the row j
+// and the thresholds being codes. Rows are requested in order, each until the next one.
+const sf::Uint8* MaskExtractor::extract(const std::function<const std::uint16_t*(int)> & rows, int s, int s2) {
+    Profiler::Scope scope(Profiler::FLOOD_FILL, (long long) WIDTH * HEIGHT);
+    scan(rows, s, s2);
+    return fill();
+}
+
+const sf::Uint8* MaskExtractor::extract(const std::function<const std::uint8_t*(int)> & rows, int s, int s2) {
+    Profiler::Scope scope(Profiler::FLOOD_FILL, (long long) WIDTH * HEIGHT);
+    scan(rows, s, s2);
+    return fill();
+}
+
+// Resolve the runs of the scan and fill the mask
+const sf::Uint8* MaskExtractor::fill() {
+    // - - - Resolve the runs: a component is in the mask if any of its runs holds a seed - - -
+    int n_runs = (int) run_start.size();
+    for (int r = 0; r < n_runs; r++) {
+        parent[r] = find(r);
+        if (run_seeded[r])
+            run_seeded[parent[r]] = 1;
+    }
+    
+    component.resize(n_runs);
+    components.clear();
+    for (int r = 0; r < n_runs; r++) {
+        component[r] = -1;
+        if (parent[r] == r && run_seeded[r]) {
+            component[r] = (int) components.size();
+            components.push_back({0, WIDTH, HEIGHT, -1, -1, 0., 0.});
+        }
+    }
+    
+    // - - - Second pass: fill the runs of the mask and their component statistics - - -
+    const sf::Uint8 RED_RGBA[4] = {255, 0, 0, 255};
+    sf::Uint32 red;
+    std::memcpy(&red, RED_RGBA, 4);
+    
+    // Only the previous foreground has to be cleared
+    for (int f = 0; f < (int) filled_start.size(); f++)
+        std::fill(pixels.begin() + filled_start[f], pixels.begin() + filled_end[f], 0);
+    filled_start.clear();
+    filled_end.clear();
+    
+    for (int r = 0; r < n_runs; r++) {
+        int c = component[parent[r]];
+        if (c < 0)
+            continue;
+        
+        int j = run_row[r], x0 = run_start[r], x1 = run_end[r];
+        filled_start.push_back(j * WIDTH + x0);
+        filled_end.push_back(j * WIDTH + x1);
+        std::fill(pixels.begin() + filled_start.back(), pixels.begin() + filled_end.back(), red);
+        
+        Component & comp = components[c];
+        int length = x1 - x0;
+        comp.area += length;
+        comp.x0 = std::min(comp.x0, x0);
+        comp.x1 = std::max(comp.x1, x1 - 1);
+        comp.y0 = std::min(comp.y0, j);
+        comp.y1 = std::max(comp.y1, j);
+        comp.cx += 0.5 * double(length) * double(x0 + x1 - 1);
+        comp.cy += double(length) * double(j);
+    }
+    
+    for (auto& comp : components) {
+        comp.cx /= comp.area;
+        comp.cy /= comp.area;
+    }
+    
+    return (const sf::Uint8*) pixels.data();
+}
+
+// Foreground components of the last extracted mask
+const std::vector<MaskExtractor::Component> & MaskExtractor::getComponents() {
+    return components;
+}
+
+void MaskExtractor::addRun(int j, int start, int end, bool loose, bool seeded) {
+    parent.push_back((int) run_start.size());
+    run_start.push_back(start);
+    run_end.push_back(end);
+    run_row.push_back(j);
+    run_loose.push_back(loose);
+    run_seeded.push_back(seeded);
+}
+
+int MaskExtractor::find(int r) {
+    // Path halving
+    while (parent[r] != r) {
+        parent[r] = parent[parent[r]];
+        r = parent[r];
+    }
+    return r;
+}
+
+void MaskExtractor::merge(int a, int b) {
+    a = find(a);
+    b = find(b);
+    
+    // The first run stays the root
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
@@ -0,0 +1,69 @@
+//
+//  MaskExtractor.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef MaskExtractor_hpp
+#define MaskExtractor_hpp
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include <SFML/Graphics.hpp>
+
+#include "Profiler.hpp"
+
+// Segmentation mask of a density plane with hysteresis thresholds
+// The pixels below s are foreground and spread to their 4-neighbours below s2. The plane is
+// cut scanline by scanline into runs of pixels, the runs touching each other are merged with
+// a union-find, and the runs of the components holding a pixel below s are written to a
+// preallocated RGBA buffer. The buffers keep their capacity from one call to the next.
+class MaskExtractor {
+public:
+    struct Component {
+        int area;
+        int x0, y0, x1, y1; // Bounding box, inclusive
+        double cx, cy;      // Centroid
+    };
+    
+    MaskExtractor();
+    
+    void create(int, int);
+    
+    const sf::Uint8* extract(const float*, float, float);
+    const sf::Uint8* extract(const std::function<const std::uint16_t*(int)> &, int, int);
+    const sf::Uint8* extract(const std::function<const std::uint8_t*(int)> &, int, int);
+    const std::vector<Component> & getComponents();
+    
+private:
+    template <typename Rows, typename Value>
+    void scan(const Rows &, Value, Value);
+    const sf::Uint8* fill();
+    
+    void addRun(int, int, int, bool, bool);
+    int find(int);
+    void merge(int, int);
+    
+    int WIDTH, HEIGHT;
+    
+    // Runs [start, end) of a row, a 'loose' run is a single seed above s2,
+    // which spreads to its neighbours but does not connect to another loose run
+    std::vector<int> run_start, run_end, run_row;
+    std::vector<char> run_loose, run_seeded;
+    std::vector<int> row_first; // First run of each row, HEIGHT + 1 entries
+    
+    std::vector<int> parent;    // Union-find over the runs
+    std::vector<int> component; // Component index of each root run, -1 if not in the mask
+    std::vector<Component> components;
+    
+    std::vector<sf::Uint32> pixels; // RGBA mask
+    std::vector<int> filled_start, filled_end; // Foreground runs of the buffer, cleared on the next call
+};
+
+#endif /* MaskExtractor_hpp */
@@ -0,0 +1,86 @@
+//
+//  MaskWriter.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "MaskWriter.hpp"
+
+MaskWriter::MaskWriter() {
+    capacity = 1;
+    closed = false;
+    failures = 0;
+}
+
+MaskWriter::~MaskWriter() {
+    finish();
+}
+
+// 'n_threads' writers, at most 'queue_size' masks waiting
+void MaskWriter::start(int n_threads, int queue_size) {
+    capacity = std::max(1, queue_size);
+    closed = false;
+    
+    for (int t = 0; t < std::max(1, n_threads); t++)
+        threads.push_back(std::thread(&MaskWriter::work, this));
+}
+
+void MaskWriter::push(std::string path, const sf::Image & mask) {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    not_full.wait(lock, [this]() { return queue.size() < capacity; });
+    
+    queue.push_back({path, mask});
+    not_empty.notify_one();
+}
+
+// Wait for the pending masks to be written
+void MaskWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        closed = true;
+    }
+    not_empty.notify_all();
+    
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+}
+
+int MaskWriter::getFailures() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return failures;
+}
+
+void MaskWriter::work() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            not_empty.wait(lock, [this]() { return closed || !queue.empty(); });
+            if (queue.empty())
+                return;
+            
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        not_full.notify_one();
+        
+        // Binary mask: white foreground on black background
+        sf::Vector2u size = job.mask.getSize();
+        Profiler::Scope scope(Profiler::ENCODE, (long long) size.x * size.y);
+        sf::Image output;
+        output.create(size.x, size.y, sf::Color::Black);
+        for (unsigned int j = 0; j < size.y; j++)
+            for (unsigned int i = 0; i < size.x; i++)
+                if (job.mask.getPixel(i, j) == sf::Color::Red)
+                    output.setPixel(i, j, sf::Color::White);
+        
+        if (!output.saveToFile(job.path)) {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            std::cout << "ERROR: cannot write " << job.path << "\n";
+            failures++;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+//
+//  MaskWriter.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef MaskWriter_hpp
+#define MaskWriter_hpp
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <SFML/Graphics.hpp>
+
+#include "Profiler.hpp"
+
+// Pool of threads encoding the masks to disk while the next ones are computed
+// The queue is bounded so the producer waits instead of piling up masks in memory.
+class MaskWriter {
+public:
+    MaskWriter();
+    ~MaskWriter();
+    
+    void start(int, int);
+    void push(std::string, const sf::Image &);
+    void finish();
+    
+    int getFailures();
+    
+private:
+    void work();
+    
+    struct Job {
+        std::string path;
+        sf::Image mask;
+    };
+    
+    std::deque<Job> queue;
+    std::size_t capacity;
+    bool closed;
+    int failures;
+    
+    std::mutex queue_mutex;
+    std::condition_variable not_empty, not_full;
+    std::vector<std::thread> threads;
+};
+
+#endif /* MaskWriter_hpp */
@@ -0,0 +1,51 @@
+//
+//  Options.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Options_hpp
+#define Options_hpp
+
+#include <string>
+#include <cstddef>
+
+#include "DensityTensor.hpp"
+#include "ColorSpace.hpp"
+#include "CompactTensor.hpp"
+#include "GMMEstimator.hpp"
+
+// Command line options
+struct Options {
+    std::string input_path = "";
+    
+    // Headless batch mode
+    bool headless = false;
+    std::string method = "mle";
+    std::string output_path = "";
+    float log_threshold = -10.;
+    float delta_log_threshold = 0.;
+    float smoothness = 0.; // Potts weight of the regularized masks, 0 for the hysteresis masks
+    float smoothing_budget = 30.; // Milliseconds of regularization a frame, 0 until convergence
+    float forgetting = 1.; // Online estimator, 1 without forgetting
+    int gmm_components = 3; // Components of the GMM of each pixel
+    GMMEstimator::Covariance gmm_covariance = GMMEstimator::DIAGONAL;
+    int window = 0; // Frames of the sliding window of the MLE and KDE, 0 for the whole sequence
+    int pyramid = 1; // Side of the blocks fitted at one pixel first, 1 to fit every pixel
+    float refine = 0.25; // Fraction of the other pixels of a pyramid fit fitted at full resolution
+    
+    std::size_t memory_budget = std::size_t(4096) * 1024 * 1024; // Bytes of decoded frames kept in RAM
+    int threads = 0; // 0 for every hardware thread
+    DensityTensor::Layout tensor_layout = DensityTensor::FRAME_MAJOR;
+    CompactTensor::Format storage = CompactTensor::FLOAT32; // Densities kept as floats or codes
+    float kde_tolerance = 0.; // 0 for the exact KDE
+    ColorSpace::Space color_space = ColorSpace::HSL;
+    bool color_table = false; // Convert through the table of every 24-bit color
+    std::string cache_path = ""; // Directory of the density cache, disabled when empty
+    std::string spill_path = ""; // Out-of-core fitting directory, disabled when empty
+    std::string trace_path = ""; // Chrome trace of the timed phases, disabled when empty
+};
+
+#endif /* Options_hpp */
@@ -0,0 +1,104 @@
+//
+//  PixelStatistics.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "PixelStatistics.hpp"
+
+PixelStatistics::PixelStatistics() {
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    space = ColorSpace::HSL;
+}
+
+// Threads of the pass, 0 for every hardware thread
+void PixelStatistics::setThreads(int n) {
+    scheduler.setThreads(n);
+}
+
+void PixelStatistics::compute(FrameStore & frames, const ColorSpace & colorspace) {
+    N = frames.size();
+    WIDTH = frames.getSize().x;
+    HEIGHT = frames.getSize().y;
+    space = colorspace.getSpace();
+    
+    std::size_t pixels = std::size_t(WIDTH) * HEIGHT;
+    for (std::vector<double>* v : {&mean_x, &mean_y, &mean_z, &c_xx, &c_xy, &c_xz, &c_yy, &c_yz, &c_zz})
+        v->assign(pixels, 0.);
+    
+    // The frames are read by bands of rows, the whole image at once when the imageset is resident
+    std::vector<sf::Uint8> band;
+    int band_rows = frames.getBandRows();
+    
+    for (int j0 = 0; j0 < HEIGHT; j0 += band_rows) {
+        int rows = std::min(band_rows, HEIGHT - j0);
+        std::vector<const sf::Uint8*> framePixels = frames.getRows(j0, rows, band);
+        
+        // Frames are added one by one to the statistics of the tile, which stay in cache
+        scheduler.run(WIDTH, rows, TILE_SIZE, [&](const TileScheduler::Tile & tile, int) {
+            int tile_width = tile.x1 - tile.x0;
+            Profiler::Scope scope(Profiler::STATISTICS, (long long) N * tile_width * (tile.y1 - tile.y0));
+            Vector3Array values(tile_width);
+            
+            for (int k = 0; k < N; k++) {
+                double w = 1. / double(k + 1);
+                
+                for (int j = tile.y0; j < tile.y1; j++) {
+                    colorspace.convert(framePixels[k] + 4 * (j * WIDTH + tile.x0), tile_width, values);
+                    
+                    std::size_t p0 = std::size_t(j0 + j) * WIDTH + tile.x0;
+                    for (int i = 0; i < tile_width; i++) {
+                        std::size_t p = p0 + i;
+                        double dx = values.x[i] - mean_x[p], dy = values.y[i] - mean_y[p], dz = values.z[i] - mean_z[p];
+                        mean_x[p] += w * dx;
+                        mean_y[p] += w * dy;
+                        mean_z[p] += w * dz;
+                        double ex = values.x[i] - mean_x[p], ey = values.y[i] - mean_y[p], ez = values.z[i] - mean_z[p];
+                        
+                        c_xx[p] += dx * ex;
+                        c_xy[p] += dx * ey;
+                        c_xz[p] += dx * ez;
+                        c_yy[p] += dy * ey;
+                        c_yz[p] += dy * ez;
+                        c_zz[p] += dz * ez;
+                    }
+                }
+            }
+        });
+    }
+}
+
+// Number of frames
+int PixelStatistics::getCount() {
+    return N;
+}
+
+// Color space of the statistics
+ColorSpace::Space PixelStatistics::getSpace() {
+    return space;
+}
+
+Vector3 PixelStatistics::getMean(int i, int j) {
+    std::size_t p = std::size_t(j) * WIDTH + i;
+    return Vector3(mean_x[p], mean_y[p], mean_z[p]);
+}
+
+// Unbiased sample covariance of the pixel (i, j)
+Matrix3 PixelStatistics::getCovariance(int i, int j) {
+    std::size_t p = std::size_t(j) * WIDTH + i;
+    double w = 1. / double(N - 1);
+    
+    return Matrix3(Vector3(w * c_xx[p], w * c_xy[p], w * c_xz[p]),
+                   Vector3(w * c_xy[p], w * c_yy[p], w * c_yz[p]),
+                   Vector3(w * c_xz[p], w * c_yz[p], w * c_zz[p]));
+}
+
+// Total variance (trace of the covariance) of the pixel (i, j)
+float PixelStatistics::getVariance(int i, int j) {
+    std::size_t p = std::size_t(j) * WIDTH + i;
+    return (c_xx[p] + c_yy[p] + c_zz[p]) / double(N - 1);
+}
@@ -0,0 +1,48 @@
+//
+//  PixelStatistics.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef PixelStatistics_hpp
+#define PixelStatistics_hpp
+
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "LinearAlgebra.hpp"
+#include "ColorSpace.hpp"
+#include "FrameStore.hpp"
+#include "TileScheduler.hpp"
+#include "Profiler.hpp"
+
+// Per pixel mean and covariance of an imageset in a color space
+// Computed in a single pass over the frames, by tiles in parallel, with Welford updates in double.
+class PixelStatistics {
+public:
+    PixelStatistics();
+    
+    void setThreads(int);
+    void compute(FrameStore &, const ColorSpace &);
+    
+    int getCount();
+    ColorSpace::Space getSpace();
+    Vector3 getMean(int, int);
+    Matrix3 getCovariance(int, int);
+    float getVariance(int, int);
+    
+private:
+    int N, WIDTH, HEIGHT;
+    ColorSpace::Space space;
+    
+    std::vector<double> mean_x, mean_y, mean_z;
+    std::vector<double> c_xx, c_xy, c_xz, c_yy, c_yz, c_zz; // Co-moment matrix (symmetric)
+    
+    TileScheduler scheduler;
+    const int TILE_SIZE = 32;
+};
+
+#endif /* PixelStatistics_hpp */
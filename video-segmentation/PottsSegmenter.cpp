@@ -0,0 +1,175 @@
+//
+//  PottsSegmenter.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "PottsSegmenter.hpp"
+
+PottsSegmenter::PottsSegmenter() {
+    WIDTH = 0;
+    HEIGHT = 0;
+    STRIDE = 0;
+    beta = 1.;
+    budget = 30.;
+    sweeps = 0;
+}
+
+void PottsSegmenter::create(int width, int height) {
+    if (width == WIDTH && height == HEIGHT)
+        return;
+    
+    WIDTH = width;
+    HEIGHT = height;
+    STRIDE = (WIDTH + 1) / 2 + 2;
+    
+    for (int c = 0; c < 2; c++) {
+        labels[c].assign(std::size_t(HEIGHT + 2) * STRIDE, 0);
+        fg_from[c].assign(std::size_t(HEIGHT + 2) * STRIDE, 0);
+        bg_below[c].assign(std::size_t(HEIGHT + 2) * STRIDE, 0);
+    }
+    row.assign(WIDTH, 1);
+}
+
+void PottsSegmenter::setThreads(int n) {
+    scheduler.setThreads(n);
+}
+
+// Cost of a pair of neighbours with different labels, in log density units
+void PottsSegmenter::setSmoothness(float b) {
+    beta = std::max(0.f, b);
+}
+
+void PottsSegmenter::setBudget(float milliseconds) {
+    budget = std::max(0.f, milliseconds);
+}
+
+// RGBA mask of the plane, red foreground on transparent background, valid until the next call
+// of the extractor. With a smoothness of 0 the mask is the plane below s.
+const sf::Uint8* PottsSegmenter::segment(const float* density, float s, float s2, MaskExtractor & extractor) {
+    Profiler::Scope scope(Profiler::REGULARIZE, (long long) WIDTH * HEIGHT);
+    auto start = std::chrono::steady_clock::now();
+    
+    initialize(density, s, s2);
+    
+    sweeps = 0;
+    while (sweeps < MAX_SWEEPS) {
+        int changes = sweep(0) + sweep(1);
+        sweeps++;
+        if (changes == 0)
+            break;
+    
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (budget > 0. && elapsed >= budget)
+            break;
+    }
+    Profiler::count(Profiler::POTTS_SWEEP, sweeps);
+    
+    // Rows of the mask interleaved from the half planes
+    extractor.create(WIDTH, HEIGHT);
+    return extractor.extract([&](int j) {
+        for (int i = 0; i < WIDTH; i++)
+            row[i] = 1 - labels[(i + j) & 1][getIndex(j, i >> 1)];
+        return (const std::uint8_t*) row.data();
+    }, 0, 0);
+}
+
+// Sweeps of the last segmentation, below the maximum when the labels converged or the budget ran out
+int PottsSegmenter::getSweeps() {
+    return sweeps;
+}
+
+std::size_t PottsSegmenter::getIndex(int j, int m) {
+    return std::size_t(j + 1) * STRIDE + m + 1;
+}
+
+// Thresholded mask, and the counts of foreground neighbours that decide the label of each pixel
+void PottsSegmenter::initialize(const float* density, float s, float s2) {
+    s2 = std::max(s, s2);
+    
+    // A pixel with n neighbours, k of them foreground, is foreground when its cost is below
+    // beta * (2k - n), that is when its density is below fg_threshold[n][k], and background when its
+    // density is above bg_threshold[n][k]. Both are increasing in k and only differ where 2k = n.
+    // Beyond n they never hold, and NaN densities compare false: never foreground, like in the extractor.
+    float fg_threshold[5][5], bg_threshold[5][5];
+    for (int n = 0; n <= 4; n++) {
+        for (int k = 0; k <= 4; k++) {
+            float g = beta * (2*k - n);
+            fg_threshold[n][k] = k > n ? -INFINITY : (g > 0. ? s2 * expf(g) : s * expf(g));
+            bg_threshold[n][k] = k > n ? INFINITY : (g < 0. ? s * expf(g) : s2 * expf(g));
+        }
+    }
+    
+    // Fewest foreground neighbours that make the pixel foreground, and most that keep it background plus one
+    auto counts = [&](float d, int n, std::uint8_t & from, std::uint8_t & below) {
+        int fg = 0, bg = 0;
+        for (int k = 0; k <= 4; k++) {
+            fg += d < fg_threshold[n][k];
+            bg += d > bg_threshold[n][k];
+        }
+        from = (std::uint8_t) (n + 1 - fg);
+        below = (std::uint8_t) bg;
+    };
+    
+    scheduler.run(1, HEIGHT, TILE_ROWS, [&](const TileScheduler::Tile & tile, int) {
+        for (int j = tile.y0; j < tile.y1; j++) {
+            const float* density_row = density + std::size_t(j) * WIDTH;
+            int n_inner = (j > 0) + (j < HEIGHT-1) + 2;
+            
+            for (int c = 0; c < 2; c++) {
+                int o = (c + j) & 1;
+                int count = (WIDTH - o + 1) / 2;
+                std::uint8_t* label = labels[c].data() + getIndex(j, 0);
+                std::uint8_t* from = fg_from[c].data() + getIndex(j, 0);
+                std::uint8_t* below = bg_below[c].data() + getIndex(j, 0);
+                
+                for (int m = 0; m < count; m++) {
+                    float d = density_row[2*m + o];
+                    counts(d, n_inner, from[m], below[m]);
+                    label[m] = d <= s ? 1 : 0;
+                }
+                
+                // The first and last pixels of the row have fewer neighbours
+                for (int m : {0, count - 1}) {
+                    int i = 2*m + o;
+                    if (m >= 0 && (i == 0 || i == WIDTH-1))
+                        counts(density_row[i], n_inner - (i == 0) - (i == WIDTH-1), from[m], below[m]);
+                }
+            }
+        }
+    });
+}
+
+// ICM on the pixels of a colour from the labels of the other one, returns the number of changed labels
+int PottsSegmenter::sweep(int colour) {
+    std::atomic<int> changes(0);
+    
+    scheduler.run(1, HEIGHT, TILE_ROWS, [&](const TileScheduler::Tile & tile, int) {
+        int tile_changes = 0;
+        for (int j = tile.y0; j < tile.y1; j++) {
+            // Pixel m of the row is at i = 2m + o, its left and right neighbours are elements
+            // m + o - 1 and m + o of the other plane, the ones above and below elements m
+            int o = (colour + j) & 1;
+            int count = (WIDTH - o + 1) / 2;
+    
+            std::uint8_t* label = labels[colour].data() + getIndex(j, 0);
+            const std::uint8_t* from = fg_from[colour].data() + getIndex(j, 0);
+            const std::uint8_t* below = bg_below[colour].data() + getIndex(j, 0);
+            const std::uint8_t* up = labels[1 - colour].data() + getIndex(j - 1, 0);
+            const std::uint8_t* down = labels[1 - colour].data() + getIndex(j + 1, 0);
+            const std::uint8_t* side = labels[1 - colour].data() + getIndex(j, 0) + o - 1;
+    
+            for (int m = 0; m < count; m++) {
+                std::uint8_t n_fg = up[m] + down[m] + side[m] + side[m + 1];
+                std::uint8_t value = n_fg >= from[m] ? 1 : (n_fg < below[m] ? 0 : label[m]);
+                tile_changes += value != label[m];
+                label[m] = value;
+            }
+        }
+        changes += tile_changes;
+    });
+    
+    return changes;
+}
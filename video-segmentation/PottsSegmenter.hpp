@@ -0,0 +1,71 @@
+//
+//  PottsSegmenter.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef PottsSegmenter_hpp
+#define PottsSegmenter_hpp
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+#include <SFML/Graphics.hpp>
+
+#include "TileScheduler.hpp"
+#include "MaskExtractor.hpp"
+#include "Profiler.hpp"
+
+// Segmentation mask of a density plane regularized by a Potts model over the 4-neighbourhood
+// The cost of a foreground pixel is the log of its density above log s2, the cost of a background
+// pixel the log of its density below log s, so that the pixels between the two thresholds are free
+// and take the label of their neighbours. Every pair of neighbours with different labels costs
+// 'beta'. The energy is lowered by checkerboard ICM from the thresholded mask: a pixel only has
+// neighbours of the other colour, so the labels of each colour are kept in their own half plane,
+// which a half sweep updates from the other one, in parallel and whatever the thread count. The
+// label a pixel takes only depends on how many of its neighbours are foreground, so the costs are
+// reduced once per frame to two counts per pixel by comparing its density to the thresholds scaled
+// by exp(beta * v), and a sweep is a loop of byte operations. Sweeps stop once no label changes
+// or the time budget is spent; the mask and its components are then read by the extractor.
+class PottsSegmenter {
+public:
+    PottsSegmenter();
+    
+    void create(int, int);
+    void setThreads(int);
+    void setSmoothness(float);
+    void setBudget(float);
+    
+    const sf::Uint8* segment(const float*, float, float, MaskExtractor &);
+    int getSweeps();
+    
+private:
+    void initialize(const float*, float, float);
+    int sweep(int);
+    std::size_t getIndex(int, int);
+    
+    int WIDTH, HEIGHT;
+    float beta;
+    float budget; // Milliseconds per frame, 0 to run until convergence
+    int sweeps;   // Sweeps of the last segmentation
+    
+    // Half planes of the pixels i + j even and odd, HEIGHT + 2 rows of STRIDE bytes with a border
+    // of background. Pixel (i, j) of colour c = (i + j) % 2 is element i / 2 of row j of plane c.
+    int STRIDE;
+    std::vector<std::uint8_t> labels[2];   // 1 foreground, 0 background
+    std::vector<std::uint8_t> fg_from[2];  // Foreground with at least this many foreground neighbours
+    std::vector<std::uint8_t> bg_below[2]; // Background with fewer foreground neighbours
+    std::vector<std::uint8_t> row;         // Row of the mask for the extractor, 0 foreground
+    
+    TileScheduler scheduler;
+    const int TILE_ROWS = 16;
+    const int MAX_SWEEPS = 50;
+};
+
+#endif /* PottsSegmenter_hpp */
@@ -0,0 +1,109 @@
+//
+//  Profiler.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "Profiler.hpp"
+
+const char* Profiler::PHASE_NAMES[PHASE_COUNT] = {"decode", "color", "statistics", "fit", "evaluate", "flood fill", "texture upload", "encode", "regularize"};
+const char* Profiler::COUNTER_NAMES[COUNTER_COUNT] = {"LRU misses", "prefetch restarts", "index builds", "index queries", "cache hits", "Potts sweeps", "viewer misses"};
+
+std::atomic<long long> Profiler::phase_time[PHASE_COUNT];
+std::atomic<long long> Profiler::phase_calls[PHASE_COUNT];
+std::atomic<long long> Profiler::phase_items[PHASE_COUNT];
+std::atomic<long long> Profiler::counters[COUNTER_COUNT];
+
+std::atomic<bool> Profiler::tracing(false);
+std::vector<Profiler::Event> Profiler::events;
+std::mutex Profiler::event_mutex;
+const std::chrono::steady_clock::time_point Profiler::origin = std::chrono::steady_clock::now();
+
+Profiler::Scope::Scope(Phase p, long long n) {
+    phase = p;
+    items = n;
+    start = std::chrono::steady_clock::now();
+}
+
+Profiler::Scope::~Scope() {
+    add(phase, start, std::chrono::steady_clock::now(), items);
+}
+
+// Record every scope from now on, for writeTrace
+void Profiler::setTrace(bool enabled) {
+    tracing = enabled;
+}
+
+void Profiler::count(Counter counter, long long n) {
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+// Table of the phases and counters that were used
+void Profiler::report() {
+    std::cout << "INFO: Time by phase (summed over threads)\n";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        long long calls = phase_calls[p], items = phase_items[p];
+        if (calls == 0)
+            continue;
+        
+        double ms = phase_time[p] * 1e-6;
+        std::printf("    %-15s %10.1f ms %9lld calls", PHASE_NAMES[p], ms, calls);
+        if (items > 0 && ms > 0.)
+            std::printf(" %10.2f Mpx/s", items / (ms * 1e3));
+        std::printf("\n");
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++)
+        if (counters[c] > 0)
+            std::printf("    %-15s %10lld\n", COUNTER_NAMES[c], (long long) counters[c]);
+    std::fflush(stdout);
+}
+
+// Chrome trace event format: one complete event per scope, timestamps in microseconds
+bool Profiler::writeTrace(std::string path) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "ERROR: cannot write " << path << "\n";
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(event_mutex);
+    file << "{\"traceEvents\": [";
+    for (std::size_t e = 0; e < events.size(); e++) {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                      e > 0 ? "," : "", PHASE_NAMES[events[e].phase], events[e].thread, events[e].start * 1e-3, events[e].duration * 1e-3);
+        file << line;
+    }
+    file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    
+    std::cout << "INFO: " << events.size() << " trace events written to " << path << "\n";
+    return bool(file);
+}
+
+void Profiler::add(Phase phase, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, long long items) {
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    phase_time[phase].fetch_add(ns, std::memory_order_relaxed);
+    phase_calls[phase].fetch_add(1, std::memory_order_relaxed);
+    phase_items[phase].fetch_add(items, std::memory_order_relaxed);
+    
+    if (!tracing.load(std::memory_order_relaxed))
+        return;
+    
+    Event event;
+    event.phase = phase;
+    event.thread = getThread();
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+    event.duration = ns;
+    
+    std::lock_guard<std::mutex> lock(event_mutex);
+    events.push_back(event);
+}
+
+// Small sequential thread ids, easier to read in a trace than the native ones
+int Profiler::getThread() {
+    static std::atomic<int> next(1);
+    thread_local int id = next++;
+    return id;
+}
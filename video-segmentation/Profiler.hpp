@@ -0,0 +1,72 @@
+//
+//  Profiler.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+
+// Time spent in each phase of a run, and optionally a Chrome trace of every timed scope
+// Scopes are placed around frames, tiles and masks, never around a single pixel, so that
+// the two clock reads and three atomic additions of a scope stay negligible. The time of
+// a phase is summed over the threads, and phases nest: color conversion is counted in
+// its own phase and in the fit that called it. Load the trace in chrome://tracing or Perfetto.
+class Profiler {
+public:
+    enum Phase { DECODE, COLOR, STATISTICS, FIT, EVALUATE, FLOOD_FILL, TEXTURE_UPLOAD, ENCODE, REGULARIZE, PHASE_COUNT };
+    enum Counter { LRU_MISS, PREFETCH_RESTART, INDEX_BUILD, INDEX_QUERY, CACHE_HIT, POTTS_SWEEP, VIEW_MISS, COUNTER_COUNT };
+    
+    // Times its lifetime into a phase, 'items' being the pixels it processed
+    class Scope {
+    public:
+        Scope(Phase, long long = 0);
+        ~Scope();
+        
+    private:
+        Phase phase;
+        long long items;
+        std::chrono::steady_clock::time_point start;
+    };
+    
+    static void setTrace(bool);
+    static void count(Counter, long long = 1);
+    
+    static void report();
+    static bool writeTrace(std::string);
+    
+private:
+    struct Event {
+        Phase phase;
+        int thread;
+        std::int64_t start, duration; // Nanoseconds since the start of the program
+    };
+    
+    static void add(Phase, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point, long long);
+    static int getThread();
+    
+    static const char* PHASE_NAMES[PHASE_COUNT];
+    static const char* COUNTER_NAMES[COUNTER_COUNT];
+    
+    static std::atomic<long long> phase_time[PHASE_COUNT], phase_calls[PHASE_COUNT], phase_items[PHASE_COUNT];
+    static std::atomic<long long> counters[COUNTER_COUNT];
+    
+    static std::atomic<bool> tracing;
+    static std::vector<Event> events;
+    static std::mutex event_mutex;
+    static const std::chrono::steady_clock::time_point origin;
+};
+
+#endif /* Profiler_hpp */
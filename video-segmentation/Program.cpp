@@ -8,21 +8,25 @@
 
 #include "Program.hpp"
 
-Program::Program(std::string inputPath) {
+Program::Program(const Options & options) {
     // Load imageset
-    loadImageset(inputPath);
+    // Out of core, half of the budget goes to the frames and half to the density bands
+    std::size_t budget = options.spill_path.empty() ? options.memory_budget : options.memory_budget / 2;
+    loaded = loadImageset(options.input_path, budget, options.threads);
+    if (!loaded)
+        return;
     
-    // Get mean/cov images
-    computeImagesetMean();
+    // Get mean/var images
+    computeImagesetStatistics(options.threads);
     texture_mean.loadFromImage(image_mean);
     sprite_mean.setTexture(texture_mean);
     
-    computeImagesetVar();
     texture_var.loadFromImage(image_var);
     sprite_var.setTexture(texture_var);
     
     // Setup sprites
     display_mode = 0;
+    frame_pending = false;
     window_scale = getWindowScale(imageset_dim);
     sprite.scale(window_scale, window_scale);
     sprite_mean.scale(window_scale, window_scale);
@@ -39,23 +43,62 @@ Program::Program(std::string inputPath) {
     threshold2 = expf(log_threshold + delta_log_threshold);
     
     // Compute segmentation mask
-    std::cout << "INFO: Running segmentation algorithm - Maximum likelihood Estimator with normal distribution\n";
-    dpestimator_mle.fit(imageset, "mle");
+    dpestimator_mle.setLayout(options.tensor_layout);
+    dpestimator_kde.setLayout(options.tensor_layout);
+    dpestimator_mle.setThreads(options.threads);
+    dpestimator_kde.setThreads(options.threads);
+    dpestimator_kde.setKDETolerance(options.kde_tolerance);
+    dpestimator_mle.setWindow(options.window);
+    dpestimator_kde.setWindow(options.window);
+    dpestimator_mle.setPyramid(options.pyramid, options.refine, {threshold, threshold2});
+    dpestimator_kde.setPyramid(options.pyramid, options.refine, {threshold, threshold2});
+    dpestimator_mle.setColorSpace(options.color_space, options.color_table);
+    dpestimator_kde.setColorSpace(options.color_space, options.color_table);
+    dpestimator_mle.setStatistics(&statistics);
+    dpestimator_mle.setSpill(options.spill_path, budget);
+    dpestimator_kde.setSpill(options.spill_path, budget);
+    dpestimator_mle.setCache(options.cache_path);
+    dpestimator_kde.setCache(options.cache_path);
+    dpestimator_mle.setStorage(options.storage, {threshold, threshold2}, budget);
+    dpestimator_kde.setStorage(options.storage, {threshold, threshold2}, budget);
+    dpestimator_gmm.setLayout(options.tensor_layout);
+    dpestimator_gmm.setThreads(options.threads);
+    dpestimator_gmm.setColorSpace(options.color_space, options.color_table);
+    dpestimator_gmm.setGMM(options.gmm_components, options.gmm_covariance);
+    dpestimator_gmm.setPyramid(options.pyramid, options.refine, {threshold, threshold2});
+    dpestimator_gmm.setSpill(options.spill_path, budget);
+    dpestimator_gmm.setCache(options.cache_path);
+    dpestimator_gmm.setStorage(options.storage, {threshold, threshold2}, budget);
+    
+    // The tiles varying the most over the sequence are fitted first
+    dpestimator_mle.setPriority(true, &statistics);
+    dpestimator_kde.setPriority(true, &statistics);
+    dpestimator_gmm.setPriority(true, &statistics);
+    kde_started = false;
+    gmm_started = false;
     
-    std::cout << "INFO: Running segmentation algorithm - Kernel density Estimator with normal kernel\n";
-    dpestimator_kde.fit(imageset, "kde");
+    // Regularized masks: from the command line, or toggled with S at the default weight
+    smoothness = options.smoothness > 0. ? options.smoothness : DEFAULT_SMOOTHNESS;
+    smoothing_budget = options.smoothing_budget;
+    smoothing = options.smoothness > 0.;
+    updateSmoothness();
+    
+    // The window opens on the frames while the MLE is fitted in the background, its masks
+    // filling in as its tiles are fitted
+    std::cout << "INFO: Running segmentation algorithm - Maximum likelihood Estimator with normal distribution\n";
+    dpestimator_mle.start(frames, "mle");
     
-    std::cout << "INFO: Extract segmentation mask\n";
     mask_mode = "mle";
-    if (mask_mode.compare("mle") == 0)
-        texture_segmentation.loadFromImage(dpestimator_mle.evaluate(imageset_index, threshold, threshold2));
-    else if (mask_mode.compare("kde") == 0)
-        texture_segmentation.loadFromImage(dpestimator_kde.evaluate(imageset_index, threshold, threshold2));
-    else {
-        std::cout << "ERROR: Unknown mask mode: " << mask_mode << std::endl;
-    }
+    shown_progress = 0.;
+    refresh_time = std::chrono::steady_clock::now();
+    texture_segmentation.create(imageset_dim.x, imageset_dim.y);
+    updateSegmentationImage();
     sprite_segmentation.setTexture(texture_segmentation);
     sprite_segmentation.scale(window_scale, window_scale);
+    
+    // Frames ahead and behind are prepared from now on
+    prefetcher.start(&frames);
+    prefetcher.request(imageset_index, getView());
 }
 
 float Program::getWindowScale(sf::Vector2u dim) {
@@ -67,13 +110,21 @@ float Program::getWindowScale(sf::Vector2u dim) {
         return scaley;
 }
 
-void Program::run() {    
+// False when the imageset could not be opened
+bool Program::run() {
+    if (!loaded)
+        return false;
+    
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
             handleEvent(event);
         }
         
+        if (frame_pending)
+            updateFrameImage();
+        refreshFitting();
+        
         window.clear();
         
         switch (display_mode) {
@@ -96,6 +147,7 @@ void Program::run() {
         
         window.display();
     }
+    return true;
 }
 
 void Program::handleEvent(sf::Event event) {
@@ -106,28 +158,24 @@ void Program::handleEvent(sf::Event event) {
         switch (event.key.code) {
             case sf::Keyboard::Right:
                 imageset_index = (imageset_index + 1)%imageset_size;
-                image.loadFromFile(imageset[imageset_index]);
-                texture.update(image);
-                
-                updateSegmentationImage();
+                prefetcher.request(imageset_index, getView());
+                updateFrameImage();
                 break;
             
             case sf::Keyboard::Left:
                 imageset_index--;
                 if (imageset_index < 0)
                     imageset_index = imageset_size - 1;
-                image.loadFromFile(imageset[imageset_index]);
-                texture.update(image);
-                
-                updateSegmentationImage();
+                prefetcher.request(imageset_index, getView());
+                updateFrameImage();
                 break;
                 
             case sf::Keyboard::Up:
-                updateThreshold(+1, 0);
+                updateThreshold(event.key.shift ? +FINE_STEP : +1., 0.);
                 break;
                 
             case sf::Keyboard::Down:
-                updateThreshold(-1, 0);
+                updateThreshold(event.key.shift ? -FINE_STEP : -1., 0.);
                 break;
                 
             case sf::Keyboard::Numpad0:
@@ -160,131 +208,114 @@ void Program::handleEvent(sf::Event event) {
                 break;
                 
             case sf::Keyboard::K:
+                // The KDE is only fitted when it is first shown
+                if (!kde_started) {
+                    std::cout << "INFO: Running segmentation algorithm - Kernel density Estimator with normal kernel\n";
+                    dpestimator_kde.start(frames, "kde");
+                    kde_started = true;
+                }
                 mask_mode = "kde";
                 updateSegmentationImage();
                 break;
                 
+            case sf::Keyboard::G:
+                // The GMM is only fitted when it is first shown
+                if (!gmm_started) {
+                    std::cout << "INFO: Running segmentation algorithm - Gaussian mixture model\n";
+                    dpestimator_gmm.start(frames, "gmm");
+                    gmm_started = true;
+                }
+                mask_mode = "gmm";
+                updateSegmentationImage();
+                break;
+                
+            case sf::Keyboard::S:
+                smoothing = !smoothing;
+                updateSmoothness();
+                updateSegmentationImage();
+                break;
+                
             case sf::Keyboard::A:
-                updateThreshold(0, +1);
+                updateThreshold(0., event.key.shift ? +FINE_STEP : +1.);
                 break;
                 
             case sf::Keyboard::Q:
-                updateThreshold(0, -1);
+                updateThreshold(0., event.key.shift ? -FINE_STEP : -1.);
                 break;
                 
             default:
                 break;
         }
     }
-}
-
-bool Program::isSupported(std::string ext) {
-    for (const auto& exti : SUPPORTED_IMAGE_FORMATS)
-        if (ext.compare(exti) == 0)
-            return true;
     
-    return false;
+    // Continuous thresholds: the wheel moves the threshold, Shift + wheel the hysteresis gap
+    if (event.type == sf::Event::MouseWheelScrolled && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+        float step = event.mouseWheelScroll.delta * FINE_STEP;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::RShift))
+            updateThreshold(0., step);
+        else
+            updateThreshold(step, 0.);
+    }
 }
 
-void Program::loadImageset(std::string inputPath) {
-    // - - - Initialise filenames - - -
-    std::vector<std::string> filenames = {};
-    
-    for (const auto& entry : fs::directory_iterator(inputPath)) {
-        std::string file_extension = entry.path().extension();
-        std::string file_name = entry.path().string();
-        if (isSupported(file_extension))
-            filenames.push_back(file_name);
-    }
-    
-    std::sort(filenames.begin(), filenames.end());
+bool Program::loadImageset(std::string inputPath, std::size_t memory_budget, int threads) {
+    // - - - Decode the frames - - -
+    if (!frames.open(inputPath, memory_budget, threads))
+        return false;
     
     // - - - Set variable - - -
-    imageset = filenames;
-    imageset_size = (int) filenames.size();
+    imageset_size = frames.size();
     imageset_index = 0;
+    imageset_dim = frames.getSize();
     
     // - - - Set image variable - - -
-    image.loadFromFile(filenames[imageset_index]);
-    texture.loadFromImage(image);
+    texture.create(imageset_dim.x, imageset_dim.y);
+    texture.update(frames.getFrame(imageset_index));
     sprite.setTexture(texture);
-    
-    imageset_dim = image.getSize();
+    return true;
 }
 
-void Program::computeImagesetMean() {
-    std::cout << "INFO: Compute mean image\n";
-    
-    image_mean.create(imageset_dim.x, imageset_dim.y);
-    std::vector<std::vector<Vector3>> temp_mean(imageset_dim.x, std::vector<Vector3>(imageset_dim.y, Vector3::Zeros()));
-    
-    // Sum all the pixels
-    for (int k = 0; k < imageset_size; k++) {
-        sf::Image image_temp;
-        image_temp.loadFromFile(imageset[k]);
-        
-        for (int i = 0; i < imageset_dim.x; i++) {
-            for (int j = 0; j < imageset_dim.y; j++) {
-                temp_mean[i][j] = temp_mean[i][j] + Vector3(image_temp.getPixel(i, j));
-            }
-        }
-    }
+// Mean and variance images, from the RGB statistics of every pixel
+void Program::computeImagesetStatistics(int threads) {
+    std::cout << "INFO: Compute mean and variance images\n";
     
-    // Compute the actual mean
-    for (int i = 0; i < imageset_dim.x; i++) {
-        for (int j = 0; j < imageset_dim.y; j++) {
-            image_mean.setPixel(i, j, (1./float(imageset_size) * temp_mean[i][j]).toColor());
-        }
-    }
-}
-
-void Program::computeImagesetVar() {
-    std::cout << "INFO: Compute variance image\n";
+    ColorSpace rgb;
+    rgb.setSpace(ColorSpace::RGB, false);
+    statistics.setThreads(threads);
+    statistics.compute(frames, rgb);
     
+    image_mean.create(imageset_dim.x, imageset_dim.y);
     image_var.create(imageset_dim.x, imageset_dim.y);
     
-    std::vector<std::vector<float>> var(imageset_dim.x, std::vector<float>(imageset_dim.y, 0.));
-    float max_cov = 0;
+    // Standard deviation over the channels, normalized to fit into [0, 255]
+    unsigned width = imageset_dim.x, height = imageset_dim.y;
+    std::vector<float> deviation(std::size_t(width) * height, 0.f);
+    float max_deviation = 0;
     
-    // Sum all variance
-    for (int k = 0; k < imageset_size; k++) {
-        sf::Image image_temp;
-        image_temp.loadFromFile(imageset[k]);
-        
-        for (int i = 0; i < imageset_dim.x; i++) {
-            for (int j = 0; j < imageset_dim.y; j++) {
-                sf::Color col = image_temp.getPixel(i, j);
-                sf::Color col_mean = image_mean.getPixel(i, j);
-                
-                var[i][j] += float(col.r - col_mean.r)*float(col.r - col_mean.r) +
-                             float(col.g - col_mean.g)*float(col.g - col_mean.g) +
-                             float(col.b - col_mean.b)*float(col.b - col_mean.b);
-            }
-        }
-    }
-    
-    // Find the maximum value
-    for (int i = 0; i < imageset_dim.x; i++) {
-        for (int j = 0; j < imageset_dim.y; j++) {
-            var[i][j] = sqrtf(var[i][j]);
-            if (var[i][j] > max_cov)
-                max_cov = var[i][j];
+    for (unsigned j = 0; j < height; j++) {
+        for (unsigned i = 0; i < width; i++) {
+            Vector3 mean = 255. * statistics.getMean(i, j);
+            image_mean.setPixel(i, j, sf::Color(std::lround(mean.x), std::lround(mean.y), std::lround(mean.z)));
+            
+            std::size_t p = std::size_t(j) * width + i;
+            deviation[p] = sqrtf(statistics.getVariance(i, j));
+            if (deviation[p] > max_deviation)
+                max_deviation = deviation[p];
         }
     }
     
-    // Normalize the variances to fit into [0, 255]
-    for (int i = 0; i < imageset_dim.x; i++) {
-        for (int j = 0; j < imageset_dim.y; j++) {
-            float val = var[i][j] / float(max_cov) * 255.;
+    for (unsigned j = 0; j < height; j++) {
+        for (unsigned i = 0; i < width; i++) {
+            float val = max_deviation > 0 ? deviation[std::size_t(j) * width + i] / max_deviation * 255. : 0.;
             image_var.setPixel(i, j, sf::Color((int) val, (int) val, (int) val));
         }
     }
 }
 
-void Program::updateThreshold(int s1, int s2) {
+// Steps on the log thresholds, the hysteresis gap never goes below 0
+void Program::updateThreshold(float s1, float s2) {
     log_threshold += s1;
-    if (s2 > 0 || delta_log_threshold > 0)
-        delta_log_threshold += s2;
+    delta_log_threshold = std::max(0.f, delta_log_threshold + s2);
     
     threshold = expf(log_threshold);
     threshold2 = expf(log_threshold + delta_log_threshold);
@@ -292,11 +323,78 @@ void Program::updateThreshold(int s1, int s2) {
     updateSegmentationImage();
 }
 
+void Program::updateSmoothness() {
+    dpestimator_mle.setSmoothness(smoothing ? smoothness : 0., smoothing_budget);
+    dpestimator_kde.setSmoothness(smoothing ? smoothness : 0., smoothing_budget);
+    dpestimator_gmm.setSmoothness(smoothing ? smoothness : 0., smoothing_budget);
+}
+
+// Frame and mask from the prefetcher, the previous ones stay on screen until they are ready
+void Program::updateFrameImage() {
+    const ViewPrefetcher::Frame* frame = prefetcher.get(imageset_index);
+    if (frame == nullptr) {
+        if (!frame_pending)
+            Profiler::count(Profiler::VIEW_MISS);
+        frame_pending = true;
+        return;
+    }
+    frame_pending = false;
+    
+    Profiler::Scope scope(Profiler::TEXTURE_UPLOAD, 2 * (long long) imageset_dim.x * imageset_dim.y);
+    texture.update(frame->pixels);
+    texture_segmentation.update(frame->mask.data());
+}
+
+// Mask of the current frame for a new view, evaluated here with the index of the estimator,
+// the prefetcher then preparing the other frames for it
 void Program::updateSegmentationImage() {
+    // The mask of a frame still to come is evaluated with it for the new view
+    if (frame_pending) {
+        prefetcher.request(imageset_index, getView());
+        return;
+    }
+    
+    shown_progress = getView().progress;
+    const sf::Uint8* mask;
     if (mask_mode.compare("mle") == 0)
-        texture_segmentation.update(dpestimator_mle.evaluate(imageset_index, threshold, threshold2));
+        mask = dpestimator_mle.evaluate(imageset_index, threshold, threshold2);
     else if (mask_mode.compare("kde") == 0)
-        texture_segmentation.update(dpestimator_kde.evaluate(imageset_index, threshold, threshold2));
-    else
+        mask = dpestimator_kde.evaluate(imageset_index, threshold, threshold2);
+    else if (mask_mode.compare("gmm") == 0)
+        mask = dpestimator_gmm.evaluate(imageset_index, threshold, threshold2);
+    else {
         std::cout << "ERROR: Unknown mask mode: " << mask_mode << std::endl;
+        return;
+    }
+    
+    {
+        Profiler::Scope scope(Profiler::TEXTURE_UPLOAD, (long long) imageset_dim.x * imageset_dim.y);
+        texture_segmentation.update(mask);
+    }
+    prefetcher.request(imageset_index, getView());
+}
+
+// Mask of the current frame again while its estimator is fitted, as its tiles are fitted
+void Program::refreshFitting() {
+    ViewPrefetcher::View view = getView();
+    float progress = view.estimator->getProgress();
+    if (progress == shown_progress)
+        return;
+    
+    auto now = std::chrono::steady_clock::now();
+    if (progress < 1. && std::chrono::duration<double>(now - refresh_time).count() < REFRESH_INTERVAL)
+        return;
+    
+    refresh_time = now;
+    updateSegmentationImage();
+}
+
+ViewPrefetcher::View Program::getView() {
+    DPEstimator* estimator = &dpestimator_mle;
+    if (mask_mode.compare("kde") == 0)
+        estimator = &dpestimator_kde;
+    else if (mask_mode.compare("gmm") == 0)
+        estimator = &dpestimator_gmm;
+    
+    return {estimator, threshold, threshold2, smoothing ? smoothness : 0.f, smoothing_budget, estimator->getProgress()};
 }
@@ -15,57 +15,77 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
 
 #include <SFML/Graphics.hpp>
 
 #include "DPEstimator.hpp"
 #include "LinearAlgebra.hpp"
+#include "FrameStore.hpp"
+#include "Options.hpp"
+#include "PixelStatistics.hpp"
+#include "Profiler.hpp"
+#include "ViewPrefetcher.hpp"
 
 namespace fs = std::filesystem;
 
 
 class Program {
 public:
-    Program(std::string);
-    void run();
+    Program(const Options &);
+    bool run();
     
 private:
-    const std::vector<std::string> SUPPORTED_IMAGE_FORMATS = {".png", ".jpg", ".jpeg"};
     const std::string TITLE = "Video Segmentation";
     const int MAX_WIDTH = 2000, MAX_HEIGHT = 1000;
     
-    bool isSupported(std::string);
-    void loadImageset(std::string);
-    void computeImagesetMean();
-    void computeImagesetVar();
+    bool loadImageset(std::string, std::size_t, int);
+    void computeImagesetStatistics(int);
     
-    void updateThreshold(int, int);
+    void updateThreshold(float, float);
+    void updateSmoothness();
+    void updateFrameImage();
     void updateSegmentationImage();
+    ViewPrefetcher::View getView();
+    void refreshFitting();
     
     float getWindowScale(sf::Vector2u);
     
     void handleEvent(sf::Event);
     
     sf::RenderWindow window;
-    sf::Image image;
     sf::Texture texture;
     sf::Sprite sprite;
     float window_scale;
     
-    std::vector<std::string> imageset;
+    FrameStore frames;
     int imageset_size, imageset_index;
     sf::Vector2u imageset_dim;
+    PixelStatistics statistics; // RGB
     sf::Image image_mean, image_var;
     sf::Texture texture_mean, texture_var;
     sf::Sprite sprite_mean, sprite_var;
     int display_mode;
     
-    DPEstimator dpestimator_mle, dpestimator_kde;
+    DPEstimator dpestimator_mle, dpestimator_kde, dpestimator_gmm;
+    bool kde_started, gmm_started; // Fitted in the background once first shown
+    float shown_progress; // Of the fit of the mask shown
+    std::chrono::steady_clock::time_point refresh_time;
+    const double REFRESH_INTERVAL = 0.25; // Seconds between the masks of a fit in progress
     std::string mask_mode;
     float threshold, log_threshold;
     float threshold2, delta_log_threshold;
+    const float FINE_STEP = 0.1;
+    bool smoothing; // Masks regularized by the Potts model
+    float smoothness, smoothing_budget;
+    const float DEFAULT_SMOOTHNESS = 1.;
     sf::Texture texture_segmentation;
     sf::Sprite sprite_segmentation;
+    
+    // Frames and masks prepared around the current frame, declared last to stop before the estimators go
+    ViewPrefetcher prefetcher;
+    bool frame_pending; // The current frame is not shown yet, waiting for the prefetcher
+    bool loaded;        // The imageset was opened, nothing else is set up otherwise
 };
 
 #endif /* Program_hpp */
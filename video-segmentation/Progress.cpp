@@ -0,0 +1,54 @@
+//
+//  Progress.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "Progress.hpp"
+
+// 'n' pixels to process
+Progress::Progress(std::string name, long long n) : total(n), done(0), next_print(INTERVAL) {
+    label = name;
+    start = std::chrono::steady_clock::now();
+    printed = false;
+}
+
+// Add 'n' processed pixels, the caller that crosses the interval prints while the others go on
+void Progress::advance(long long n) {
+    long long d = done.fetch_add(n, std::memory_order_relaxed) + n;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (elapsed < next_print.load(std::memory_order_relaxed))
+        return;
+    
+    std::unique_lock<std::mutex> lock(print_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || elapsed < next_print)
+        return;
+    next_print = elapsed + INTERVAL;
+    print(d, elapsed);
+}
+
+// Add 'n' pixels to process, fewer when negative, for jobs whose size is known as they go
+void Progress::add(long long n) {
+    total += n;
+}
+
+// Final line with the mean throughput, when progress was shown
+void Progress::finish() {
+    std::lock_guard<std::mutex> lock(print_mutex);
+    if (!printed)
+        return;
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("INFO: %s done in %.1f s, %.2f Mpx/s\n", label.c_str(), elapsed, done / elapsed * 1e-6);
+    std::fflush(stdout);
+}
+
+void Progress::print(long long d, double elapsed) {
+    double rate = d / elapsed;
+    double eta = rate > 0. ? (total - d) / rate : 0.;
+    std::printf("INFO: %s %5.1f%%  %.2f Mpx/s  ETA %.0f s\n", label.c_str(), 100. * d / total, rate * 1e-6, eta);
+    std::fflush(stdout);
+    printed = true;
+}
@@ -0,0 +1,42 @@
+//
+//  Progress.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Progress_hpp
+#define Progress_hpp
+
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+
+// Progress of a long job advanced from several threads, printed at most once per interval
+// with the throughput and the estimated remaining time. Jobs shorter than the interval print nothing.
+class Progress {
+public:
+    Progress(std::string, long long);
+    
+    void advance(long long);
+    void add(long long);
+    void finish();
+    
+private:
+    void print(long long, double);
+    
+    static constexpr double INTERVAL = 1.; // Seconds
+    
+    std::string label;
+    std::atomic<long long> total;
+    std::atomic<long long> done;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<double> next_print; // Seconds since start
+    std::mutex print_mutex;
+    bool printed;
+};
+
+#endif /* Progress_hpp */
@@ -0,0 +1,67 @@
+//
+//  SPSCQueue.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef SPSCQueue_hpp
+#define SPSCQueue_hpp
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <algorithm>
+
+// Bounded lock-free queue between a single producer thread and a single consumer thread
+// The elements are preallocated slots handed out in place: the producer fills the slot returned
+// by claim() and publishes it, the consumer reads the slot returned by front() and pops it. The
+// buffers of a slot are thus reused from one element to the next, and neither side ever waits
+// for the other: claim() and front() return nullptr when the queue is full or empty.
+template <typename T>
+class SPSCQueue {
+public:
+    SPSCQueue() : head(0), tail(0) {}
+    
+    // Before the threads start
+    void create(int capacity) {
+        slots = std::vector<T>(std::max(1, capacity));
+        head.store(0);
+        tail.store(0);
+    }
+    
+    // Producer
+    T* claim() {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size())
+            return nullptr;
+        return &slots[t % slots.size()];
+    }
+    
+    void publish() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Consumer
+    T* front() {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots[h % slots.size()];
+    }
+    
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    int capacity() {
+        return (int) slots.size();
+    }
+    
+private:
+    std::vector<T> slots;
+    std::atomic<std::size_t> head, tail; // Elements popped and published, the slot of element e is e % capacity
+};
+
+#endif /* SPSCQueue_hpp */
@@ -0,0 +1,93 @@
+//
+//  StreamingMLEstimator.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "StreamingMLEstimator.hpp"
+
+StreamingMLEstimator::StreamingMLEstimator() {
+    n_pixels = 0;
+    forgetting = 1.;
+}
+
+// Reset the model of 'pixels' pixels, lambda in (0, 1], 1 without forgetting
+void StreamingMLEstimator::create(int pixels, float lambda) {
+    n_pixels = pixels;
+    forgetting = lambda;
+    
+    weight.assign(n_pixels, 0.);
+    mean = Vector3Array(n_pixels);
+    c_xx.assign(n_pixels, 0.);
+    c_xy.assign(n_pixels, 0.);
+    c_xz.assign(n_pixels, 0.);
+    c_yy.assign(n_pixels, 0.);
+    c_yz.assign(n_pixels, 0.);
+    c_zz.assign(n_pixels, 0.);
+}
+
+void StreamingMLEstimator::setThreads(int n) {
+    scheduler.setThreads(n);
+}
+
+// Add a frame to the model and write its (proportionnal) density, the frame being part of the fit
+// like in MLEstimator. The density is 1 as long as the covariance is undefined.
+void StreamingMLEstimator::update(const Vector3Array & frame, float* density) {
+    const int CHUNK = 4096;
+    
+    scheduler.run(n_pixels, 1, CHUNK, [&](const TileScheduler::Tile & tile, int) {
+        for (int p = tile.x0; p < tile.x1; p++) {
+            // Welford update with exponential forgetting
+            Vector3 x = frame.get(p);
+            Vector3 delta = x - mean.get(p);
+            
+            weight[p] = forgetting * weight[p] + 1.;
+            mean.set(p, mean.get(p) + 1./weight[p] * delta);
+            Vector3 delta2 = x - mean.get(p);
+            
+            c_xx[p] = forgetting * c_xx[p] + delta.x * delta2.x;
+            c_xy[p] = forgetting * c_xy[p] + delta.x * delta2.y;
+            c_xz[p] = forgetting * c_xz[p] + delta.x * delta2.z;
+            c_yy[p] = forgetting * c_yy[p] + delta.y * delta2.y;
+            c_yz[p] = forgetting * c_yz[p] + delta.y * delta2.z;
+            c_zz[p] = forgetting * c_zz[p] + delta.z * delta2.z;
+            
+            if (weight[p] <= 1.) {
+                density[p] = 1.;
+                continue;
+            }
+            
+            // Unbiased covariance, weight - 1 being the effective number of degrees of freedom
+            Matrix3 cov = 1./(weight[p] - 1.) * Matrix3(Vector3(c_xx[p], c_xy[p], c_xz[p]),
+                                                         Vector3(c_xy[p], c_yy[p], c_yz[p]),
+                                                         Vector3(c_xz[p], c_yz[p], c_zz[p]));
+            Matrix3 cov_inv = cov.inverse();
+            
+            density[p] = GaussianKernel::exp(-0.5 * delta2 * (cov_inv * delta2));
+        }
+    });
+}
+
+// Running statistics of every pixel, to resume the stream later with the same forgetting factor
+void StreamingMLEstimator::getState(std::vector<float> & state) {
+    const std::vector<float>* planes[10] = {&weight, &mean.x, &mean.y, &mean.z, &c_xx, &c_xy, &c_xz, &c_yy, &c_yz, &c_zz};
+    
+    state.clear();
+    state.reserve(10 * std::size_t(n_pixels));
+    for (const std::vector<float>* plane : planes)
+        state.insert(state.end(), plane->begin(), plane->end());
+}
+
+// Restore statistics saved by getState after create, false if they do not match the pixel count
+bool StreamingMLEstimator::setState(const std::vector<float> & state) {
+    if (state.size() != 10 * std::size_t(n_pixels))
+        return false;
+    
+    std::vector<float>* planes[10] = {&weight, &mean.x, &mean.y, &mean.z, &c_xx, &c_xy, &c_xz, &c_yy, &c_yz, &c_zz};
+    for (int c = 0; c < 10; c++)
+        std::copy(state.begin() + c * std::size_t(n_pixels), state.begin() + (c+1) * std::size_t(n_pixels), planes[c]->begin());
+    
+    return true;
+}
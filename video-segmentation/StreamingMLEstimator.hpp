@@ -0,0 +1,47 @@
+//
+//  StreamingMLEstimator.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef StreamingMLEstimator_hpp
+#define StreamingMLEstimator_hpp
+
+#include <vector>
+#include <algorithm>
+
+#include "LinearAlgebra.hpp"
+#include "GaussianKernel.hpp"
+#include "TileScheduler.hpp"
+
+// Online Maximum Likelihood Estimator (Normal distribution), one model per pixel
+// Every pixel keeps running sufficient statistics (weight, Welford mean and co-moment matrix),
+// so a frame is ingested in O(pixels) and the memory does not depend on the sequence length.
+// With a forgetting factor lambda < 1 the past frames are weighted by lambda^age.
+class StreamingMLEstimator {
+public:
+    StreamingMLEstimator();
+    
+    void create(int, float);
+    void setThreads(int);
+    
+    void update(const Vector3Array &, float*);
+    
+    void getState(std::vector<float> &);
+    bool setState(const std::vector<float> &);
+    
+private:
+    int n_pixels;
+    float forgetting;
+    
+    // Per pixel statistics
+    std::vector<float> weight;
+    Vector3Array mean;
+    std::vector<float> c_xx, c_xy, c_xz, c_yy, c_yz, c_zz; // Co-moment matrix (symmetric)
+    
+    TileScheduler scheduler;
+};
+
+#endif /* StreamingMLEstimator_hpp */
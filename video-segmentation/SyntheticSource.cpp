@@ -0,0 +1,144 @@
+//
+//  SyntheticSource.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "SyntheticSource.hpp"
+
+SyntheticSource::SyntheticSource() {
+    N = 0;
+    WIDTH = 0;
+    HEIGHT = 0;
+    seed = 0;
+}
+
+// "synthetic:<width>x<height>x<frames>[:<seed>]"
+bool SyntheticSource::parse(std::string spec, int & width, int & height, int & frames, std::uint64_t & seed) {
+    unsigned long long s = 0;
+    int read = std::sscanf(spec.c_str(), "synthetic:%dx%dx%d:%llu", &width, &height, &frames, &s);
+    seed = s;
+    return read >= 3 && width > 0 && height > 0 && frames > 0;
+}
+
+bool SyntheticSource::open(std::string s) {
+    spec = s;
+    if (!parse(spec, WIDTH, HEIGHT, N, seed)) {
+        std::cout << "ERROR: expected synthetic:<width>x<height>x<frames>[:<seed>], got " << spec << "\n";
+        return false;
+    }
+    
+    // Background: a few smooth waves per channel, scaled with the image so that every resolution shows the same scene
+    background.resize(3 * std::size_t(WIDTH) * HEIGHT);
+    for (int j = 0; j < HEIGHT; j++) {
+        for (int i = 0; i < WIDTH; i++) {
+            float x = float(i) / WIDTH, y = float(j) / HEIGHT;
+            float* rgb = &background[3 * (std::size_t(j) * WIDTH + i)];
+            rgb[0] = 110.f + 50.f * std::sin(6.f * x + 2.f * y) + 20.f * std::sin(31.f * x * y);
+            rgb[1] = 120.f + 40.f * std::cos(4.f * y - 3.f * x) + 15.f * std::sin(23.f * y);
+            rgb[2] = 100.f + 45.f * std::sin(5.f * x + 7.f * y + 1.f);
+        }
+    }
+    
+    // Blobs drawn from the seed, with a radius and a speed relative to the image
+    std::uint64_t state = seed;
+    auto uniform = [&]() { state = mix(state + 0x9e3779b97f4a7c15ull); return float(state >> 40) / float(1 << 24); };
+    float scale = float(std::min(WIDTH, HEIGHT));
+    blobs.resize(BLOB_COUNT);
+    for (Blob& blob : blobs) {
+        blob.x = uniform() * WIDTH;
+        blob.y = uniform() * HEIGHT;
+        blob.vx = (uniform() - 0.5f) * 0.04f * scale;
+        blob.vy = (uniform() - 0.5f) * 0.04f * scale;
+        blob.radius = (0.05f + 0.07f * uniform()) * scale;
+        blob.r = 255.f * uniform();
+        blob.g = 255.f * uniform();
+        blob.b = 255.f * uniform();
+    }
+    
+    return true;
+}
+
+int SyntheticSource::size() {
+    return N;
+}
+
+sf::Vector2u SyntheticSource::getSize() {
+    return sf::Vector2u(WIDTH, HEIGHT);
+}
+
+std::string SyntheticSource::getName(int k) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "synthetic-%06d", k);
+    return name;
+}
+
+std::string SyntheticSource::getIdentity(int k) {
+    return spec + "#" + std::to_string(k);
+}
+
+bool SyntheticSource::isSeekable() {
+    return true;
+}
+
+bool SyntheticSource::read(int k, sf::Uint8* dst) {
+    float gain = 1.f + DRIFT * std::sin(6.2831853f * k / DRIFT_PERIOD);
+    
+    for (std::size_t p = 0; p < std::size_t(WIDTH) * HEIGHT; p++) {
+        const float* rgb = &background[3 * p];
+        dst[4 * p + 0] = (sf::Uint8) std::min(255.f, gain * rgb[0]);
+        dst[4 * p + 1] = (sf::Uint8) std::min(255.f, gain * rgb[1]);
+        dst[4 * p + 2] = (sf::Uint8) std::min(255.f, gain * rgb[2]);
+        dst[4 * p + 3] = 255;
+    }
+    
+    // Blobs over the bounding box of each disc, the later ones in front
+    for (const Blob& blob : blobs) {
+        float cx = bounce(blob.x + blob.vx * k, float(WIDTH)), cy = bounce(blob.y + blob.vy * k, float(HEIGHT));
+        int i0 = std::max(0, int(cx - blob.radius)), i1 = std::min(WIDTH - 1, int(cx + blob.radius));
+        int j0 = std::max(0, int(cy - blob.radius)), j1 = std::min(HEIGHT - 1, int(cy + blob.radius));
+        for (int j = j0; j <= j1; j++) {
+            for (int i = i0; i <= i1; i++) {
+                float dx = i - cx, dy = j - cy;
+                if (dx * dx + dy * dy > blob.radius * blob.radius)
+                    continue;
+                sf::Uint8* px = &dst[4 * (std::size_t(j) * WIDTH + i)];
+                px[0] = (sf::Uint8) std::min(255.f, gain * blob.r);
+                px[1] = (sf::Uint8) std::min(255.f, gain * blob.g);
+                px[2] = (sf::Uint8) std::min(255.f, gain * blob.b);
+            }
+        }
+    }
+    
+    // Noise: sum of four uniform bytes of a hash of the seed, the frame and the sample, close to a normal law
+    std::uint64_t frame_key = mix(seed ^ (std::uint64_t(k) << 32));
+    for (std::size_t p = 0; p < std::size_t(WIDTH) * HEIGHT; p++) {
+        for (int c = 0; c < 3; c++) {
+            std::uint64_t h = mix(frame_key + 3 * p + c);
+            int sum = int(h & 0xff) + int((h >> 8) & 0xff) + int((h >> 16) & 0xff) + int((h >> 24) & 0xff) - 510;
+            // The sum has a standard deviation of 147.8 levels
+            int value = dst[4 * p + c] + int(std::lround(sum * (NOISE_SIGMA / 147.8f)));
+            dst[4 * p + c] = (sf::Uint8) std::max(0, std::min(255, value));
+        }
+    }
+    
+    return true;
+}
+
+// SplitMix64 finalizer
+std::uint64_t SyntheticSource::mix(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Position along [0, extent) of a point moving freely, reflected on the borders
+float SyntheticSource::bounce(float x, float extent) {
+    float period = 2.f * extent;
+    x = std::fmod(x, period);
+    if (x < 0.f)
+        x += period;
+    return x < extent ? x : period - x;
+}
@@ -0,0 +1,65 @@
+//
+//  SyntheticSource.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef SyntheticSource_hpp
+#define SyntheticSource_hpp
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSource.hpp"
+
+// Deterministic test sequence, opened from "synthetic:<width>x<height>x<frames>[:<seed>]"
+// A static textured background under a slow global lighting drift, sensor noise, and a few
+// coloured blobs moving in straight lines and bouncing on the borders. Every frame is a pure
+// function of its index and the seed, so that benchmarks see the same pixels on every machine.
+class SyntheticSource : public FrameSource {
+public:
+    SyntheticSource();
+    
+    static bool parse(std::string, int &, int &, int &, std::uint64_t &);
+    
+    bool open(std::string);
+    
+    int size();
+    sf::Vector2u getSize();
+    std::string getName(int);
+    std::string getIdentity(int);
+    bool isSeekable();
+    
+    bool read(int, sf::Uint8*);
+    
+private:
+    struct Blob {
+        float x, y, vx, vy, radius;
+        float r, g, b;
+    };
+    
+    static std::uint64_t mix(std::uint64_t);
+    static float bounce(float, float);
+    
+    static const int BLOB_COUNT = 4;
+    static constexpr float NOISE_SIGMA = 4.f;   // Grey levels
+    static constexpr float DRIFT = 0.15f;       // Amplitude of the lighting gain
+    static constexpr float DRIFT_PERIOD = 97.f; // Frames
+    
+    std::string spec;
+    int N, WIDTH, HEIGHT;
+    std::uint64_t seed;
+    
+    std::vector<float> background; // RGB, before the lighting gain
+    std::vector<Blob> blobs;
+};
+
+#endif /* SyntheticSource_hpp */
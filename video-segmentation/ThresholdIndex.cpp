@@ -0,0 +1,187 @@
+//
+//  ThresholdIndex.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "ThresholdIndex.hpp"
+
+ThresholdIndex::ThresholdIndex() {
+    WIDTH = 0;
+    HEIGHT = 0;
+    size = 0;
+    level_max = -1.;
+    count = 0;
+    filled = 0;
+}
+
+// Index the pixels of the plane up to the density 'maximum'
+void ThresholdIndex::build(const float* density, int width, int height, float maximum) {
+    if (width != WIDTH || height != HEIGHT) {
+        WIDTH = width;
+        HEIGHT = height;
+        size = WIDTH * HEIGHT;
+        
+        rank.assign(size, -1);
+        pixels.assign(size, 0);
+    } else {
+        // Clear the previous mask and ranks
+        for (int t = 0; t < filled; t++)
+            pixels[order[t]] = 0;
+        for (int t = 0; t < count; t++)
+            rank[order[t]] = -1;
+    }
+    filled = 0;
+    level_max = maximum;
+    
+    // Pixels below the maximum level, NaN densities never pass a threshold
+    order.clear();
+    keys.clear();
+    for (int p = 0; p < size; p++) {
+        if (density[p] <= level_max) {
+            float d = std::max(density[p], 0.f);
+            sf::Uint32 key;
+            std::memcpy(&key, &d, sizeof(float));
+            order.push_back(p);
+            keys.push_back(key);
+        }
+    }
+    count = (int) order.size();
+    sort();
+    
+    sorted.resize(count);
+    parent.resize(count);
+    lowest.resize(count);
+    zpar.resize(count);
+    representative.resize(count);
+    component.resize(count);
+    
+    for (int t = 0; t < count; t++) {
+        rank[order[t]] = t;
+        std::memcpy(&sorted[t], &keys[t], sizeof(float));
+    }
+    
+    // Merge the pixels by increasing density, each new pixel becoming the parent
+    // of the components of its already merged neighbours
+    for (int t = 0; t < count; t++) {
+        int p = order[t];
+        parent[t] = t;
+        zpar[t] = t;
+        lowest[t] = t;
+        
+        int i = p % WIDTH, j = p / WIDTH;
+        int neighbours[4] = {i > 0 ? p-1 : -1, i+1 < WIDTH ? p+1 : -1, j > 0 ? p-WIDTH : -1, j+1 < HEIGHT ? p+WIDTH : -1};
+        
+        for (int n : neighbours) {
+            if (n < 0 || rank[n] < 0 || rank[n] > t)
+                continue;
+            
+            int r = find(rank[n]);
+            if (r != t) {
+                parent[r] = t;
+                zpar[r] = t;
+                lowest[t] = std::min(lowest[t], lowest[r]);
+            }
+        }
+    }
+}
+
+// Maximum s2 the index can answer
+float ThresholdIndex::getLevelMax() {
+    return level_max;
+}
+
+// RGBA mask of the pixels below s2 connected to a pixel below s, s <= s2 <= getLevelMax(),
+// valid until the next call
+const sf::Uint8* ThresholdIndex::query(float s, float s2) {
+    Profiler::Scope scope(Profiler::FLOOD_FILL, (long long) WIDTH * HEIGHT);
+    Profiler::count(Profiler::INDEX_QUERY);
+    // Pixels below s2
+    int n = (int) (std::upper_bound(sorted.begin(), sorted.end(), s2) - sorted.begin());
+    
+    // Component of each pixel at level s2, parents come later in the order
+    for (int t = n - 1; t >= 0; t--) {
+        int q = parent[t];
+        representative[t] = (q != t && sorted[q] <= s2) ? representative[q] : t;
+        component[t] = -1;
+    }
+    
+    // Clear the previous mask, then fill the components going below s
+    for (int t = 0; t < filled; t++)
+        pixels[order[t]] = 0;
+    filled = n;
+    
+    const sf::Uint8 RED_RGBA[4] = {255, 0, 0, 255};
+    sf::Uint32 red;
+    std::memcpy(&red, RED_RGBA, 4);
+    
+    components.clear();
+    for (int t = 0; t < n; t++) {
+        int r = representative[t];
+        if (sorted[lowest[r]] > s)
+            continue;
+        
+        int p = order[t];
+        pixels[p] = red;
+        
+        if (component[r] < 0) {
+            component[r] = (int) components.size();
+            components.push_back({0, WIDTH, HEIGHT, -1, -1, 0., 0.});
+        }
+        MaskExtractor::Component & comp = components[component[r]];
+        int i = p % WIDTH, j = p / WIDTH;
+        comp.area++;
+        comp.x0 = std::min(comp.x0, i);
+        comp.x1 = std::max(comp.x1, i);
+        comp.y0 = std::min(comp.y0, j);
+        comp.y1 = std::max(comp.y1, j);
+        comp.cx += i;
+        comp.cy += j;
+    }
+    
+    for (auto& comp : components) {
+        comp.cx /= comp.area;
+        comp.cy /= comp.area;
+    }
+    
+    return (const sf::Uint8*) pixels.data();
+}
+
+// Foreground components of the last query
+const std::vector<MaskExtractor::Component> & ThresholdIndex::getComponents() {
+    return components;
+}
+
+// Stable LSD radix sort of the indexed pixels on the bits of their density,
+// which order like the floats themselves for non negative values
+void ThresholdIndex::sort() {
+    keys_tmp.resize(count);
+    order_tmp.resize(count);
+    
+    for (int shift = 0; shift < 32; shift += 8) {
+        int histogram[257] = {0};
+        for (int t = 0; t < count; t++)
+            histogram[((keys[t] >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++)
+            histogram[b+1] += histogram[b];
+        
+        for (int t = 0; t < count; t++) {
+            int dst = histogram[(keys[t] >> shift) & 0xFF]++;
+            keys_tmp[dst] = keys[t];
+            order_tmp[dst] = order[t];
+        }
+        keys.swap(keys_tmp);
+        order.swap(order_tmp);
+    }
+}
+
+int ThresholdIndex::find(int t) {
+    // Path halving
+    while (zpar[t] != t) {
+        zpar[t] = zpar[zpar[t]];
+        t = zpar[t];
+    }
+    return t;
+}
@@ -0,0 +1,66 @@
+//
+//  ThresholdIndex.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef ThresholdIndex_hpp
+#define ThresholdIndex_hpp
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+#include <SFML/Graphics.hpp>
+
+#include "MaskExtractor.hpp"
+#include "Profiler.hpp"
+
+// Component tree (min-tree) of a density plane, built once per frame
+// The pixels below a maximum level are sorted by density and merged in that order with a
+// union-find: the parent of a node is reached at a higher density and every node knows the
+// first (lowest) node of its subtree. The component of a pixel at level s2 is its highest
+// ancestor below s2, so the mask of any (s, s2) pair, s <= s2 <= maximum level, is read from
+// the pixels below s2 only: those whose component goes below s.
+// Nodes are stored by rank in the density order, which keeps the queries sequential.
+class ThresholdIndex {
+public:
+    ThresholdIndex();
+    
+    void build(const float*, int, int, float);
+    float getLevelMax();
+    
+    const sf::Uint8* query(float, float);
+    const std::vector<MaskExtractor::Component> & getComponents();
+    
+private:
+    void sort();
+    int find(int);
+    
+    int WIDTH, HEIGHT, size;
+    float level_max;
+    int count;                    // Number of indexed pixels
+    
+    std::vector<int> order;       // Indexed pixels by increasing density
+    std::vector<float> sorted;    // Their densities
+    std::vector<int> rank;        // Rank of each pixel in the order, -1 if not indexed
+    std::vector<int> parent;      // Component tree, by rank
+    std::vector<int> lowest;      // Lowest rank of each subtree
+    
+    std::vector<int> zpar;        // Union-find while building
+    std::vector<sf::Uint32> keys; // Radix sort buffers
+    std::vector<int> order_tmp;
+    std::vector<sf::Uint32> keys_tmp;
+    
+    std::vector<int> representative; // Component of each rank at the queried level
+    std::vector<int> component;
+    std::vector<MaskExtractor::Component> components;
+    
+    std::vector<sf::Uint32> pixels; // RGBA mask
+    int filled;                     // Ranks [0, filled) may be set in the buffer
+};
+
+#endif /* ThresholdIndex_hpp */
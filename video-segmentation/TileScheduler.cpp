@@ -0,0 +1,105 @@
+//
+//  TileScheduler.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "TileScheduler.hpp"
+
+TileScheduler::TileScheduler() {
+    setThreads(0);
+}
+
+// 0 uses every hardware thread
+void TileScheduler::setThreads(int n) {
+    if (n <= 0)
+        n = (int) std::thread::hardware_concurrency();
+    n_threads = std::max(1, n);
+}
+
+int TileScheduler::getThreads() {
+    return n_threads;
+}
+
+// Run task(tile, thread) over the width x height image cut in tile_size x tile_size tiles
+void TileScheduler::run(int width, int height, int tile_size, const std::function<void(const Tile &, int)> & task) {
+    run(cut(width, height, tile_size), false, task);
+}
+
+// Same, the tiles of highest priority first
+void TileScheduler::run(int width, int height, int tile_size, const std::function<void(const Tile &, int)> & task,
+                        const std::function<float(const Tile &)> & priority) {
+    std::vector<Tile> tiles = cut(width, height, tile_size);
+    std::vector<float> priorities(tiles.size());
+    std::vector<int> order(tiles.size());
+    for (int t = 0; t < (int) tiles.size(); t++) {
+        priorities[t] = priority(tiles[t]);
+        order[t] = t;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return priorities[a] > priorities[b]; });
+    
+    std::vector<Tile> sorted;
+    for (int t : order)
+        sorted.push_back(tiles[t]);
+    run(sorted, true, task);
+}
+
+// Cut the image in tiles, row by row
+std::vector<TileScheduler::Tile> TileScheduler::cut(int width, int height, int tile_size) {
+    std::vector<Tile> tiles;
+    for (int y0 = 0; y0 < height; y0 += tile_size)
+        for (int x0 = 0; x0 < width; x0 += tile_size)
+            tiles.push_back({x0, y0, std::min(x0 + tile_size, width), std::min(y0 + tile_size, height)});
+    return tiles;
+}
+
+void TileScheduler::run(const std::vector<Tile> & tiles, bool interleaved, const std::function<void(const Tile &, int)> & task) {
+    int n = std::max(1, std::min(n_threads, (int) tiles.size()));
+    
+    // Deal contiguous runs of tiles to each thread, or one tile to each in turn
+    queues = std::vector<std::deque<Tile>>(n);
+    queues_mutex = std::vector<std::mutex>(n);
+    for (int t = 0; t < (int) tiles.size(); t++)
+        queues[interleaved ? t % n : (long) t * n / tiles.size()].push_back(tiles[t]);
+    
+    auto worker = [&](int thread) {
+        Tile tile;
+        while (pop(thread, tile))
+            task(tile, thread);
+    };
+    
+    std::vector<std::thread> threads;
+    for (int t = 1; t < n; t++)
+        threads.push_back(std::thread(worker, t));
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+bool TileScheduler::pop(int thread, Tile & tile) {
+    // Own deque first
+    {
+        std::lock_guard<std::mutex> lock(queues_mutex[thread]);
+        if (!queues[thread].empty()) {
+            tile = queues[thread].front();
+            queues[thread].pop_front();
+            return true;
+        }
+    }
+    
+    // Then steal from the others
+    int n = (int) queues.size();
+    for (int t = 1; t < n; t++) {
+        int victim = (thread + t) % n;
+        std::lock_guard<std::mutex> lock(queues_mutex[victim]);
+        if (!queues[victim].empty()) {
+            tile = queues[victim].back();
+            queues[victim].pop_back();
+            return true;
+        }
+    }
+    
+    return false;
+}
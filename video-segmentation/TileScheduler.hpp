@@ -0,0 +1,49 @@
+//
+//  TileScheduler.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef TileScheduler_hpp
+#define TileScheduler_hpp
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+
+// Parallel loop over the tiles of an image
+// Every thread starts with a contiguous run of tiles in its own deque, pops them from
+// the front and, once empty, steals from the back of the other threads' deques. With a
+// priority, the tiles are dealt in turn by decreasing priority instead, so that the threads
+// all run the first tiles first and steal the last ones.
+class TileScheduler {
+public:
+    struct Tile {
+        int x0, y0, x1, y1; // [x0, x1) x [y0, y1)
+    };
+    
+    TileScheduler();
+    
+    void setThreads(int);
+    int getThreads();
+    
+    void run(int, int, int, const std::function<void(const Tile &, int)> &);
+    void run(int, int, int, const std::function<void(const Tile &, int)> &, const std::function<float(const Tile &)> &);
+    
+private:
+    void run(const std::vector<Tile> &, bool, const std::function<void(const Tile &, int)> &);
+    std::vector<Tile> cut(int, int, int);
+    bool pop(int, Tile &);
+    
+    int n_threads;
+    
+    std::vector<std::deque<Tile>> queues;
+    std::vector<std::mutex> queues_mutex;
+};
+
+#endif /* TileScheduler_hpp */
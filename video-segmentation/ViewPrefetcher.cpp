@@ -0,0 +1,166 @@
+//
+//  ViewPrefetcher.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "ViewPrefetcher.hpp"
+
+ViewPrefetcher::ViewPrefetcher() {
+    frames = nullptr;
+    target = 0;
+    view = {nullptr, 0., 0., 0., 0., 0.};
+    generation = 0;
+    serial = 0;
+    stopping = false;
+    sent = 0;
+    received = 0;
+    
+    // Nearest frames first, the next one before the previous one at the same distance
+    offsets.push_back(0);
+    for (int d = 1; d <= std::max(AHEAD, BEHIND); d++) {
+        if (d <= AHEAD)
+            offsets.push_back(d);
+        if (d <= BEHIND)
+            offsets.push_back(-d);
+    }
+}
+
+ViewPrefetcher::~ViewPrefetcher() {
+    stop();
+}
+
+// The prepared frames are dropped
+void ViewPrefetcher::start(FrameStore* store) {
+    stop();
+    
+    frames = store;
+    queue.create(QUEUE_SIZE);
+    cache = std::vector<Frame>(CACHE_SIZE);
+    sent_index.assign(CACHE_SIZE, -1);
+    sent_generation.assign(CACHE_SIZE, -1);
+    sent = 0;
+    received = 0;
+    serial = 0;
+    stopping = false;
+    
+    thread = std::thread(&ViewPrefetcher::work, this);
+}
+
+void ViewPrefetcher::stop() {
+    if (!thread.joinable())
+        return;
+    
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        stopping = true;
+    }
+    requested.notify_one();
+    thread.join();
+}
+
+// Prepare the frames around 'index' for 'view'
+void ViewPrefetcher::request(int index, const View & v) {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        if (v.estimator != view.estimator || v.threshold != view.threshold || v.threshold2 != view.threshold2 ||
+            v.smoothness != view.smoothness || v.smoothing_budget != view.smoothing_budget || v.progress != view.progress)
+            generation++;
+        target = index;
+        view = v;
+        serial++;
+    }
+    requested.notify_one();
+}
+
+// Frame 'index' prepared for the last view requested, nullptr if it is not ready yet.
+// Valid until the next call.
+const ViewPrefetcher::Frame* ViewPrefetcher::get(int index) {
+    for (Frame* frame = queue.front(); frame != nullptr; frame = queue.front()) {
+        std::swap(cache[received % CACHE_SIZE], *frame);
+        received++;
+        queue.pop();
+    }
+    
+    for (const Frame & frame : cache)
+        if (frame.index == index && frame.generation == generation)
+            return &frame;
+    return nullptr;
+}
+
+void ViewPrefetcher::work() {
+    std::unique_lock<std::mutex> lock(request_mutex);
+    long served = 0;
+    
+    while (true) {
+        requested.wait(lock, [&]() { return stopping || serial != served; });
+        if (stopping)
+            return;
+    
+        served = serial;
+        int center = target, gen = generation;
+        View v = view;
+        lock.unlock();
+    
+        int N = frames->size();
+        for (int d : offsets) {
+            if (isInterrupted(served))
+                break;
+            
+            int k = ((center + d) % N + N) % N;
+            if (isSent(k, gen))
+                continue;
+            
+            // The render loop pops the queue at every frame it draws
+            Frame* frame = queue.claim();
+            while (frame == nullptr && !isInterrupted(served)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                frame = queue.claim();
+            }
+            if (frame == nullptr)
+                break;
+            
+            frame->generation = gen;
+            prepare(*frame, k, v);
+            queue.publish();
+            
+            sent_index[sent % CACHE_SIZE] = k;
+            sent_generation[sent % CACHE_SIZE] = gen;
+            sent++;
+        }
+        
+        lock.lock();
+    }
+}
+
+void ViewPrefetcher::prepare(Frame & frame, int k, const View & v) {
+    sf::Vector2u size = frames->getSize();
+    std::size_t bytes = 4 * std::size_t(size.x) * size.y;
+    
+    frame.index = k;
+    if (frames->isResident())
+        frame.pixels = frames->getFrame(k);
+    else {
+        frame.buffer.resize(bytes);
+        frames->copyFrame(k, 0, bytes, frame.buffer.data());
+        frame.pixels = frame.buffer.data();
+    }
+    
+    evaluation.smoothness = v.smoothness;
+    evaluation.smoothing_budget = v.smoothing_budget;
+    const sf::Uint8* mask = v.estimator->evaluate(k, v.threshold, v.threshold2, evaluation);
+    frame.mask.assign(mask, mask + bytes);
+}
+
+bool ViewPrefetcher::isSent(int k, int gen) {
+    for (int s = 0; s < CACHE_SIZE; s++)
+        if (sent_index[s] == k && sent_generation[s] == gen)
+            return true;
+    return false;
+}
+
+bool ViewPrefetcher::isInterrupted(long served) {
+    return stopping || serial != served;
+}
@@ -0,0 +1,94 @@
+//
+//  ViewPrefetcher.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef ViewPrefetcher_hpp
+#define ViewPrefetcher_hpp
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include <SFML/Graphics.hpp>
+
+#include "DPEstimator.hpp"
+#include "FrameStore.hpp"
+#include "SPSCQueue.hpp"
+#include "Profiler.hpp"
+
+// Worker thread of the viewer preparing the frames around the current one with their masks
+// The worker reads the frames from the current one to AHEAD frames after it and BEHIND frames before,
+// nearest first, and evaluates their masks for the current view with its own buffers. The prepared
+// frames go to the render loop through a lock-free queue, whose slots are swapped with the ones of a
+// cache of the last CACHE_SIZE frames received, so that the buffers are never reallocated. Since the
+// queue is in order, the last CACHE_SIZE frames sent are in the queue or in the cache, which is how
+// the worker skips the frames the render loop already has. A new request interrupts the current one.
+class ViewPrefetcher {
+public:
+    // What the masks are evaluated for, a change invalidates the prepared masks
+    struct View {
+        DPEstimator* estimator;
+        float threshold, threshold2;
+        float smoothness, smoothing_budget; // Smoothness 0 for the hysteresis masks
+        float progress;                     // Of the fit of the estimator, below 1 while it is fitted
+    };
+    
+    struct Frame {
+        int index = -1, generation = -1;
+        const sf::Uint8* pixels = nullptr; // RGBA, in the store when it is resident, in 'buffer' otherwise
+        std::vector<sf::Uint8> buffer;
+        std::vector<sf::Uint8> mask;       // RGBA
+    };
+    
+    ViewPrefetcher();
+    ~ViewPrefetcher();
+    
+    void start(FrameStore*);
+    void stop();
+    
+    void request(int, const View &);
+    const Frame* get(int);
+    
+private:
+    void work();
+    void prepare(Frame &, int, const View &);
+    bool isSent(int, int);
+    bool isInterrupted(long);
+    
+    static constexpr int AHEAD = 3, BEHIND = 1;
+    static constexpr int CACHE_SIZE = AHEAD + BEHIND + 2;
+    static constexpr int QUEUE_SIZE = 2;
+    std::vector<int> offsets; // Of the frames to prepare from the current one, in order
+    
+    FrameStore* frames;
+    DPEstimator::Evaluation evaluation;
+    
+    // Request, written by the render loop
+    int target;
+    View view;
+    int generation;
+    std::atomic<long> serial; // Incremented by every request
+    std::atomic<bool> stopping;
+    std::mutex request_mutex;
+    std::condition_variable requested;
+    std::thread thread;
+    
+    // Worker side
+    std::vector<int> sent_index, sent_generation; // Last CACHE_SIZE frames sent, in a ring
+    long sent;
+    
+    // Render loop side
+    SPSCQueue<Frame> queue;
+    std::vector<Frame> cache;
+    long received; // The next frame received replaces cache[received % CACHE_SIZE]
+};
+
+#endif /* ViewPrefetcher_hpp */
@@ -0,0 +1,218 @@
+//
+//  Y4MSource.cpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#include "Y4MSource.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    inline sf::Uint8 clamp(int v) {
+        return (sf::Uint8) (v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+    
+    // FNV-1a over 8-byte words, then the remaining bytes, never 0
+    std::uint64_t hash(const sf::Uint8* data, std::size_t size) {
+        std::uint64_t h = 14695981039346656037ull;
+        std::size_t p = 0;
+        for (; p + 8 <= size; p += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data + p, 8);
+            h = (h ^ word) * 1099511628211ull;
+        }
+        for (; p < size; p++)
+            h = (h ^ data[p]) * 1099511628211ull;
+        return h | 1;
+    }
+}
+
+Y4MSource::Y4MSource() {
+    file = -1;
+    WIDTH = 0;
+    HEIGHT = 0;
+    chroma_width = 0;
+    chroma_height = 0;
+    frame_size = 0;
+}
+
+Y4MSource::~Y4MSource() {
+    if (file >= 0)
+        close(file);
+}
+
+bool Y4MSource::open(std::string p) {
+    path = p;
+    file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        std::cout << "ERROR: cannot open " << path << "\n";
+        return false;
+    }
+    
+    std::string header;
+    if (!readHeader(header) || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        std::cout << "ERROR: " << path << " is not a YUV4MPEG2 file\n";
+        return false;
+    }
+    
+    // Parameters: W<width> H<height> C<chroma>, the others (frame rate, aspect...) are ignored
+    std::string chroma = "420jpeg";
+    std::istringstream tokens(header.substr(10));
+    std::string token;
+    while (tokens >> token) {
+        if (token[0] == 'W')
+            WIDTH = std::stoi(token.substr(1));
+        else if (token[0] == 'H')
+            HEIGHT = std::stoi(token.substr(1));
+        else if (token[0] == 'C')
+            chroma = token.substr(1);
+    }
+    
+    // 8 bit samples only: 420, 420jpeg, 420mpeg2 and 420paldv differ by the chroma siting, 420p10 is 10 bit
+    if (chroma == "420" || chroma == "420jpeg" || chroma == "420mpeg2" || chroma == "420paldv") {
+        chroma_width = (WIDTH + 1) / 2;
+        chroma_height = (HEIGHT + 1) / 2;
+    } else if (chroma == "422") {
+        chroma_width = (WIDTH + 1) / 2;
+        chroma_height = HEIGHT;
+    } else if (chroma == "444") {
+        chroma_width = WIDTH;
+        chroma_height = HEIGHT;
+    } else if (chroma == "mono") {
+        chroma_width = 0;
+        chroma_height = 0;
+    } else {
+        std::cout << "ERROR: unsupported Y4M chroma format C" << chroma << " in " << path << "\n";
+        return false;
+    }
+    if (WIDTH <= 0 || HEIGHT <= 0) {
+        std::cout << "ERROR: missing dimensions in " << path << "\n";
+        return false;
+    }
+    frame_size = std::size_t(WIDTH) * HEIGHT + 2 * std::size_t(chroma_width) * chroma_height;
+    
+    // Index the frames: each one is a "FRAME[ parameters]" line followed by the planes
+    std::int64_t file_size = lseek(file, 0, SEEK_END);
+    std::int64_t position = header.size() + 1;
+    char line[256];
+    while (position < file_size) {
+        ssize_t n = pread(file, line, sizeof(line), position);
+        char* end = n > 0 ? (char*) std::memchr(line, '\n', n) : nullptr;
+        if (end == nullptr || std::strncmp(line, "FRAME", 5) != 0)
+            break;
+        
+        std::int64_t data = position + (end - line) + 1;
+        if (data + (std::int64_t) frame_size > file_size)
+            break; // Truncated last frame
+        offsets.push_back(data);
+        position = data + frame_size;
+    }
+    
+    if (offsets.empty()) {
+        std::cout << "ERROR: no frame in " << path << "\n";
+        return false;
+    }
+    
+    hashes = std::vector<std::atomic<std::uint64_t>>(offsets.size());
+    for (auto & h : hashes)
+        h = 0;
+    return true;
+}
+
+// First line of the file, without the newline
+bool Y4MSource::readHeader(std::string & header) {
+    char c;
+    std::int64_t position = 0;
+    while (pread(file, &c, 1, position++) == 1) {
+        if (c == '\n')
+            return true;
+        header.push_back(c);
+        if (header.size() > 4096)
+            return false;
+    }
+    return false;
+}
+
+int Y4MSource::size() {
+    return (int) offsets.size();
+}
+
+sf::Vector2u Y4MSource::getSize() {
+    return sf::Vector2u(WIDTH, HEIGHT);
+}
+
+std::string Y4MSource::getName(int k) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%06d", k);
+    return std::filesystem::path(path).stem().string() + "-" + number;
+}
+
+// Position of the frame and a hash of all its bytes, frames appended to the file keep the identity
+// of the previous ones. The hash is the one of the last read, the frame is read for it otherwise.
+std::string Y4MSource::getIdentity(int k) {
+    std::uint64_t h = hashes[k];
+    if (h == 0) {
+        std::vector<sf::Uint8> planes(frame_size);
+        h = readPlanes(k, planes.data()) ? hashes[k].load() : 0;
+    }
+    
+    return path + "#" + std::to_string(k) + "@" + std::to_string(offsets[k]) + "|" + std::to_string(h);
+}
+
+bool Y4MSource::isSeekable() {
+    return true;
+}
+
+// Planes of the frame k, whose hash is kept for its identity
+bool Y4MSource::readPlanes(int k, sf::Uint8* planes) {
+    std::size_t done = 0;
+    while (done < frame_size) {
+        ssize_t n = pread(file, planes + done, frame_size - done, offsets[k] + done);
+        if (n <= 0) {
+            std::cout << "ERROR: cannot read frame " << k << " of " << path << "\n";
+            return false;
+        }
+        done += n;
+    }
+    
+    hashes[k] = hash(planes, frame_size);
+    return true;
+}
+
+// BT.601 limited range YUV to RGBA, chroma upsampled by replication
+bool Y4MSource::read(int k, sf::Uint8* dst) {
+    std::vector<sf::Uint8> planes(frame_size);
+    if (!readPlanes(k, planes.data())) {
+        std::memset(dst, 0, 4 * std::size_t(WIDTH) * HEIGHT);
+        return false;
+    }
+    
+    const sf::Uint8* Y = planes.data();
+    const sf::Uint8* U = Y + std::size_t(WIDTH) * HEIGHT;
+    const sf::Uint8* V = U + std::size_t(chroma_width) * chroma_height;
+    
+    for (int j = 0; j < HEIGHT; j++) {
+        int cj = chroma_height > 0 ? j * chroma_height / HEIGHT : 0;
+        for (int i = 0; i < WIDTH; i++) {
+            int c = 298 * (Y[std::size_t(j) * WIDTH + i] - 16);
+            int d = 0, e = 0;
+            if (chroma_width > 0) {
+                std::size_t q = std::size_t(cj) * chroma_width + i * chroma_width / WIDTH;
+                d = U[q] - 128;
+                e = V[q] - 128;
+            }
+            
+            sf::Uint8* pixel = dst + 4 * (std::size_t(j) * WIDTH + i);
+            pixel[0] = clamp((c + 409 * e + 128) >> 8);
+            pixel[1] = clamp((c - 100 * d - 208 * e + 128) >> 8);
+            pixel[2] = clamp((c + 516 * d + 128) >> 8);
+            pixel[3] = 255;
+        }
+    }
+    
+    return true;
+}
@@ -0,0 +1,55 @@
+//
+//  Y4MSource.hpp
+//  video-segmentation
+//
+//  Created by Stephen Jaud on 17/10/2026.
+//  Copyright © 2026 Stephen Jaud. All rights reserved.
+//
+
+#ifndef Y4MSource_hpp
+#define Y4MSource_hpp
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+#include <filesystem>
+#include <atomic>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSource.hpp"
+
+// Uncompressed YUV4MPEG2 video, 8-bit 4:2:0, 4:2:2, 4:4:4 or mono
+// The frame offsets are indexed once when the file is opened, so that any frame is read with a
+// single positioned read (from several threads), then converted with the BT.601 matrix.
+class Y4MSource : public FrameSource {
+public:
+    Y4MSource();
+    ~Y4MSource();
+    
+    bool open(std::string);
+    
+    int size();
+    sf::Vector2u getSize();
+    std::string getName(int);
+    std::string getIdentity(int);
+    bool isSeekable();
+    
+    bool read(int, sf::Uint8*);
+    
+private:
+    bool readHeader(std::string &);
+    bool readPlanes(int, sf::Uint8*);
+    
+    std::string path;
+    int file;
+    int WIDTH, HEIGHT;
+    int chroma_width, chroma_height; // 0 for mono
+    std::size_t frame_size;          // Bytes of the planes of a frame
+    std::vector<std::int64_t> offsets; // Planes of each frame
+    std::vector<std::atomic<std::uint64_t>> hashes; // Of the planes of each frame when last read, 0 before
+};
+
+#endif /* Y4MSource_hpp */
@@ -7,23 +7,94 @@
 //
 
 #include <string>
+#include <cstring>
 #include <iostream>
 
+#include "Options.hpp"
 #include "Program.hpp"
+#include "Batch.hpp"
+#include "Profiler.hpp"
 
 int main(int argc, const char * argv[]) {
-    // Get the input path
-    std::string inputPath = "";
-    for (int i = 0; i < argc; i++)
+    // Get the options
+    Options options;
+    for (int i = 0; i < argc; i++) {
         if (argc > i+1 && std::strcmp(argv[i], "-i") == 0)
-            inputPath = std::string(argv[i+1]);
+            options.input_path = std::string(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--memory") == 0)
+            options.memory_budget = std::size_t(std::stoul(argv[i+1])) * 1024 * 1024;
+        if (argc > i+1 && std::strcmp(argv[i], "--threads") == 0)
+            options.threads = std::stoi(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--layout") == 0)
+            options.tensor_layout = std::strcmp(argv[i+1], "pixel") == 0 ? DensityTensor::PIXEL_MAJOR : DensityTensor::FRAME_MAJOR;
+        if (argc > i+1 && std::strcmp(argv[i], "--storage") == 0 && !CompactTensor::parse(argv[i+1], options.storage)) {
+            std::cout << "ERROR: unknown storage: " << argv[i+1] << "\n";
+            return 1;
+        }
+        if (argc > i+1 && std::strcmp(argv[i], "--kde-tolerance") == 0)
+            options.kde_tolerance = std::stof(argv[i+1]);
+        if (std::strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        if (argc > i+1 && std::strcmp(argv[i], "--method") == 0)
+            options.method = std::string(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--out") == 0)
+            options.output_path = std::string(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--threshold") == 0)
+            options.log_threshold = std::stof(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--threshold2") == 0)
+            options.delta_log_threshold = std::stof(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--smoothness") == 0)
+            options.smoothness = std::stof(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--smoothing-budget") == 0)
+            options.smoothing_budget = std::stof(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--forgetting") == 0)
+            options.forgetting = std::stof(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--gmm-components") == 0)
+            options.gmm_components = std::stoi(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--gmm-covariance") == 0 && !GMMEstimator::parse(argv[i+1], options.gmm_covariance)) {
+            std::cout << "ERROR: unknown covariance: " << argv[i+1] << "\n";
+            return 1;
+        }
+        if (argc > i+1 && std::strcmp(argv[i], "--window") == 0)
+            options.window = std::stoi(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--pyramid") == 0)
+            options.pyramid = std::stoi(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--refine") == 0)
+            options.refine = std::stof(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--color") == 0 && !ColorSpace::parse(argv[i+1], options.color_space)) {
+            std::cout << "ERROR: unknown color space: " << argv[i+1] << "\n";
+            return 1;
+        }
+        if (std::strcmp(argv[i], "--color-table") == 0)
+            options.color_table = true;
+        if (argc > i+1 && std::strcmp(argv[i], "--spill") == 0)
+            options.spill_path = std::string(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--cache") == 0)
+            options.cache_path = std::string(argv[i+1]);
+        if (argc > i+1 && std::strcmp(argv[i], "--trace") == 0)
+            options.trace_path = std::string(argv[i+1]);
+    }
     
-    // If input path is given we run the program
-    if (inputPath.compare("") != 0) {
-        Program program(inputPath);
-        program.run();
-    } else
+    // If input path is given we run the program, or the batch without window
+    if (options.input_path.compare("") == 0) {
         std::cout << "ERROR: input path not given\n";
+        return 1;
+    }
     
-    return 0;
+    Profiler::setTrace(!options.trace_path.empty());
+    
+    bool success = true;
+    if (options.headless) {
+        Batch batch(options);
+        success = batch.run();
+    } else {
+        Program program(options);
+        success = program.run();
+    }
+    
+    Profiler::report();
+    if (!options.trace_path.empty())
+        Profiler::writeTrace(options.trace_path);
+    
+    return success ? 0 : 1;
 }